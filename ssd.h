@@ -27,7 +27,12 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <deque>
+#include <functional>
 #include <map>
+#include <set>
+#include <vector>
+#include <unordered_map>
 
 #ifndef _SSD_H
 #define _SSD_H
@@ -56,14 +61,10 @@ extern const double RAM_WRITE_DELAY;
 /* Bus class:
  * 	delay to communicate over bus
  * 	max number of connected devices allowed
- * 	flag value to detect free table entry (keep this negative)
- * 	number of time entries bus has to keep track of future schedule usage
  * 	number of simultaneous communication channels - defined by SSD_SIZE */
 extern const double BUS_CTRL_DELAY;
 extern const double BUS_DATA_DELAY;
 extern const unsigned int BUS_MAX_CONNECT;
-extern const double BUS_CHANNEL_FREE_FLAG;
-extern const unsigned int BUS_TABLE_SIZE;
 /* extern const unsigned int BUS_CHANNELS = 4; same as # of Packages, defined by SSD_SIZE */
 
 /* Ssd class:
@@ -108,31 +109,6 @@ extern const float OVERPROVISIONING;
 /* Log file path */
 extern const char LOG_FILE[255];
 
-/* Define macros for fetching the package number, die number, plane number,
- * block number and page numbe for a given logical address.
- */
-
-#define GET_DIVIDE_NUM(logical_addr,val) (logical_addr / (unsigned long)(val))
-#define GET_MOD_NUM(logical_addr,val) (logical_addr % (unsigned long)(val))  
-#define GET_LOGICAL_ADDR(package_num,die_num,plane_num,block_num) (package_num * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE) + \
- 			                                                            (die_num * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE) + \
- 			                                                            (plane_num * PLANE_SIZE * BLOCK_SIZE) + \
- 			                                                            (block_num * BLOCK_SIZE)
-
-typedef struct{
-		/* Package number of the log block */
-    unsigned int package_num;
-    /* Die number of the log block */
-    unsigned int die_num;
-    /* Plane number of the log block */
-    unsigned int plane_num; 
-    /* Number of blocks per plane */
-    unsigned int block_num; 
-    /* Pointer to an array that tracks the pages of a log block */
-    int *page_entries; 
-	} LOG_BLOCK;
-
-
 /* Enumerations to clarify status integers in simulation
  * Do not use typedefs on enums for reader clarity */
 
@@ -157,6 +133,12 @@ enum block_state{FREE, ACTIVE, INACTIVE};
  * 	           to free pages in block at merge_address */
 enum event_type{READ, WRITE, ERASE, MERGE};
 
+/* Scheduled event types of the discrete event simulation
+ * 	arrival    - a host request reaches the drive
+ * 	completion - a host request finishes
+ * 	idle gc    - the drive cleans for a step while it is idle */
+enum sched_type{ARRIVAL, COMPLETION, IDLE_GC};
+
 /* General return status
  * return status for simulator operations that only need to provide general
  * failure notifications */
@@ -178,6 +160,79 @@ enum GC_POLICY{FIFO, LRU, GREEDY, COST_BENEFIT};
 /* Selected garbage collection policy */
 extern enum GC_POLICY SELECTED_GC_POLICY;
 
+/* FTL implementations
+ * HYBRID: log-block FTL with data pages fixed to their logical address.
+ * PAGE_MAPPED: page-level mapping with out-of-place writes.
+ * DFTL: page-level mapping with a demand-cached mapping table.
+ * FAST: hybrid FTL with one sequential log block and a shared pool of random
+ * 	log blocks. */
+enum FTL_TYPE{HYBRID, PAGE_MAPPED, DFTL, FAST};
+/* Selected FTL implementation */
+extern const unsigned int FTL_IMPLEMENTATION;
+
+/* DFTL mapping table:
+ * 	number of mapping entries cached in controller RAM */
+extern const unsigned int MAP_CACHE_SIZE;
+
+/* Background garbage collection:
+ * 	time the drive has to be idle between requests before it cleans in the
+ * 		background, 0 disables background cleaning
+ * 	percentage of the overprovisioned blocks background cleaning keeps
+ * 		free */
+extern const double GC_IDLE_THRESHOLD;
+extern const float GC_IDLE_WATERMARK;
+
+/* Incremental garbage collection:
+ * 	pages a request copies for cleaning that was started earlier, 0 cleans
+ * 		blocks completely as they are needed
+ * 	percentage of the overprovisioned blocks below which requests clean
+ * 		incrementally */
+extern const unsigned int GC_STEP_PAGES;
+extern const float GC_STEP_WATERMARK;
+
+/* Hybrid FTL cleaning blocks:
+ * 	number of overprovisioned blocks full merges gather pages in, spread
+ * 		over the dies */
+extern const unsigned int CLEANING_BLOCKS;
+
+/* Static wear leveling:
+ * 	difference in erases between the most and least worn blocks above which
+ * 		the data of the least worn block is moved while the drive is idle,
+ * 		0 disables static wear leveling
+ * 	percentage of the elapsed time the moves can take */
+extern const unsigned int WL_THRESHOLD;
+extern const float WL_RATE;
+
+/* Page-mapped FTL write streams:
+ * 	0: every write takes the write frontier of the plane
+ * 	1: host writes are split into hot, warm and cold streams by how often
+ * 		their logical page is updated, and cleaning writes to a stream of
+ * 		its own, each stream filling its own blocks */
+extern const unsigned int STREAM_SEPARATION;
+
+/* Write throttling:
+ * 	longest time a host write is held for while the drive cleans, 0
+ * 		disables throttling
+ * 	percentages of the overprovisioned blocks free at and below which
+ * 		writes are held the longest, and from which they are not held */
+extern const double THROTTLE_DELAY;
+extern const float THROTTLE_LOW_WATERMARK;
+extern const float THROTTLE_HIGH_WATERMARK;
+
+/* Host interface arbitration between submission queues
+ * ROUND_ROBIN: one command from each queue in turn.
+ * WEIGHTED_ROUND_ROBIN: as many commands from each queue in turn as its
+ * 	weight. */
+enum HOST_ARBITRATION_TYPE{ROUND_ROBIN, WEIGHTED_ROUND_ROBIN};
+
+/* Host interface:
+ * 	number of submission and completion queue pairs
+ * 	commands a queue pair can have outstanding, submitted and not completed
+ * 	selected arbitration between the submission queues */
+extern const unsigned int HOST_NUM_QUEUES;
+extern const unsigned int HOST_QUEUE_DEPTH;
+extern const unsigned int HOST_ARBITRATION;
+
 /* List classes up front for classes that have references to their "parent"
  * (e.g. a Package's parent is a Ssd).
  *
@@ -188,9 +243,15 @@ extern enum GC_POLICY SELECTED_GC_POLICY;
  * (e.g. a Ssd contains a Controller, Ram, Bus, and Packages). */
 class Address;
 class Event;
+class Event_pool;
+class Scheduler;
+class Host_interface;
 class Channel;
 class Bus;
 class Page;
+class Wear_index;
+class Victim_index;
+class Policy_index;
 class Block;
 class Plane;
 class Die;
@@ -198,6 +259,8 @@ class Package;
 class Garbage_Collector;
 class Wear_Leveler;
 class Ftl;
+class Mapping_cache;
+class Page_ftl;
 class Ram;
 class Controller;
 class Ssd;
@@ -228,6 +291,113 @@ public:
   bool operator!=(const Address &rhs);
 };
 
+/* Divisor fixed at configuration time.  Powers of two divide with a shift
+ * and a mask.  Other divisors get a precomputed 64-bit magic number so that
+ * quotients and remainders of 32-bit numerators take a multiply instead of a
+ * divide (Lemire et al., "Faster Remainder by Direct Computation"). */
+struct Divider
+{
+	unsigned long divisor;
+	unsigned long mask;
+	unsigned long magic;
+	unsigned int shift;
+	bool power_of_two;
+	void init(unsigned long divisor);
+};
+
+/* Geometry of the SSD used to translate between logical page addresses and
+ * (package, die, plane, block, page) addresses without a chain of 64-bit
+ * divides.  Logical pages are laid out in the same order as physical pages:
+ * BLOCK_SIZE pages per block, PLANE_SIZE blocks per plane and so on.
+ * init_geometry() sets up the global GEOMETRY from the configuration and is
+ * called by load_config().  When every size is a power of two the shift and
+ * mask specialization of the translation is used, otherwise the magic number
+ * one is used. */
+class Geometry
+{
+public:
+	void init(unsigned int ssd_size, unsigned int package_size, unsigned int die_size, unsigned int plane_size, unsigned int block_size);
+	void decompose(unsigned long logical_address, Address &address) const;
+	unsigned long compose(const Address &address) const;
+	unsigned long get_block(unsigned long logical_address) const;
+	unsigned int get_page(unsigned long logical_address) const;
+	unsigned long get_num_blocks(void) const;
+	unsigned long get_num_pages(void) const;
+	unsigned long pack(const Address &address) const;
+	void unpack(unsigned long packed, Address &address) const;
+private:
+	template <bool POWER_OF_TWO> void _decompose(unsigned long logical_address, Address &address) const;
+	bool power_of_two;
+	unsigned long num_blocks;
+	unsigned int field_shift[PAGE + 1];
+	unsigned long field_mask[PAGE + 1];
+	Divider package_size;
+	Divider die_size;
+	Divider plane_size;
+	Divider block_size;
+};
+extern Geometry GEOMETRY;
+void init_geometry(void);
+
+/* Physical page address packed into 64 bits.  The widths of the package, die,
+ * plane, block and page fields are sized from the loaded geometry (see
+ * Geometry::pack), and the address_valid status is kept in the top bits.  A
+ * Ppa takes 8 bytes where an Address takes 24 and two Ppas compare with a
+ * single instruction, so mapping tables and GC bookkeeping store Ppas and
+ * convert to Address when issuing events.  Use Ppa_hash to key hashed
+ * containers on Ppas. */
+class Ppa
+{
+public:
+	Ppa(void);
+	Ppa(const Address &address);
+	Address get_address(void) const;
+	void get_address(Address &address) const;
+	enum address_valid get_valid(void) const;
+	unsigned long hash(void) const;
+	unsigned long get_value(void) const { return value; }
+	bool operator==(const Ppa &rhs) const { return value == rhs.value; }
+	bool operator!=(const Ppa &rhs) const { return value != rhs.value; }
+	bool operator<(const Ppa &rhs) const { return value < rhs.value; }
+private:
+	unsigned long value;
+};
+
+struct Ppa_hash
+{
+	size_t operator()(const Ppa &ppa) const { return ppa.hash(); }
+};
+
+typedef struct{
+    /* Packed physical address of the log block */
+    Ppa block;
+    /* Logical block the log block belongs to (BAST log block or FAST
+     * sequential log block) */
+    unsigned long logical_block;
+    /* Pointer to an array that tracks the pages of a log block.  Entries are
+     * page offsets in the data block, or logical page numbers for FAST
+     * random log blocks, and -1 for empty pages. */
+    int *page_entries; 
+    /* Reverse of page_entries: index of the latest copy of each page offset
+     * of the data block, -1 if there is none.  Unused for FAST random log
+     * blocks. */
+    int *page_index;
+    /* Index of the next empty page, BLOCK_SIZE if the log block is full */
+    unsigned int cursor;
+    /* Times the log block was mapped to its logical block and last written,
+     * counted in log block events, for the FIFO and LRU cleaning policies */
+    unsigned long mapped_time;
+    unsigned long written_time;
+    /* Index of the log block in Ftl::log_blocks */
+    unsigned long number;
+    /* BAST only: pages of the data block written so far, whether the log
+     * block holds the first pages of the data block in order, and the pages
+     * a merge would copy, kept up to date for the cleaning policies */
+    unsigned int num_written;
+    bool in_order;
+    unsigned int merge_cost;
+	} LOG_BLOCK;
+
 /* Class to manage I/O requests as events for the SSD.  It was designed to keep
  * track of an I/O request by storing its type, addressing, and timing.  The
  * SSD class creates an instance for each I/O request it receives. */
@@ -264,46 +434,98 @@ private:
 	Event *next;
 };
 
-/* Quicksort for Channel class
- * Supply base pointer to array to be sorted along with inclusive range of
- * indices to sort.  The move operations for sorting the first array will also
- * be performed on the second array, or the second array can be NULL.  The
- * second array is useful for the channel scheduling table where we want to
- * sort by one row and keep data pairs in columns together. */
-/* extern "C" void quicksort(double *array1, double *array2, long left, long right); */
-void quicksort(double *array1, double *array2, long left, long right);
-/* internal quicksort functions listed for documentation purposes
- * long partition(double *array1, double *array2, long left, long right);
- * void swap(double *x, double *y); */
+/* Fixed pool of single page events the FTL builds its internal requests in.
+ * Events are taken in order and linked with Event::set_next to the last
+ * event of the list they are taken for, so the events in use form up to
+ * num_lists lists, each for one call to Controller::issue.  clear makes every
+ * event available again. */
+class Event_pool
+{
+public:
+	Event_pool(unsigned int size, unsigned int num_lists = 1);
+	~Event_pool(void);
+	Event &get(enum event_type type, unsigned long logical_address, double start_time, unsigned int list = 0);
+	Event *get_list(unsigned int list = 0) const;
+	unsigned int get_num_lists(void) const;
+	bool is_full(void) const;
+	void clear(void);
+private:
+	unsigned int size;
+	unsigned int used;
+	Event * const events;
+	std::vector<Event *> heads;
+	std::vector<Event *> tails;
+};
+
+/* A scheduled event of the discrete event simulation: its time, the order it
+ * was scheduled in to break ties, its type and a tag telling its owner what
+ * it is for (e.g. the id of a host request). */
+struct Sched_event
+{
+	double time;
+	unsigned long order;
+	enum sched_type type;
+	unsigned long tag;
+};
+
+/* Pending events of the discrete event simulation in a binary heap keyed on
+ * time, with events at the same time taken in the order they were scheduled.
+ * The clock is the time of the last event taken.  Scheduling and taking an
+ * event are O(log n). */
+class Scheduler
+{
+public:
+	Scheduler(void);
+	~Scheduler(void);
+	void schedule(double time, enum sched_type type, unsigned long tag);
+	bool next(Sched_event &event, double until);
+	bool is_empty(void) const;
+	double get_time(void) const;
+	double get_next_time(void) const;
+private:
+	std::vector<Sched_event> heap;
+	double now;
+	unsigned long order;
+};
+
+/* Host request of the asynchronous interface, see Ssd::submit.  The drive
+ * fills in the outcome when it completes. */
+struct Request
+{
+	unsigned long id;
+	enum event_type type;
+	unsigned long logical_address;
+	unsigned int size;
+	double arrive_time;
+	double finish_time;
+	double bus_wait_time;
+	enum status status;
+	Address address;
+};
 
 /* Single bus channel
  * Simulate multiple devices on 1 bus channel with variable bus transmission
  * durations for data and control delays with the Channel class.  Provide the 
  * delay times to send a control signal or 1 page of data across the bus
- * channel, the bus table size for the maximum number channel transmissions that
- * can be queued, and the maximum number of devices that can connect to the bus.
- * To elaborate, the table size is the size of the channel scheduling table that
- * holds start and finish times of events that have not yet completed in order
- * to determine where the next event can be scheduled for bus utilization. */
+ * channel and the maximum number of devices that can connect to the bus.
+ * The busy intervals of transmissions that have not yet completed are kept
+ * in an ordered map from start to finish time, with touching intervals
+ * merged, to find the first gap where the next event can be scheduled. */
 class Channel
 {
 public:
-	Channel(double ctrl_delay = BUS_CTRL_DELAY, double data_delay = BUS_DATA_DELAY, unsigned int table_size = BUS_TABLE_SIZE, unsigned int max_connections = BUS_MAX_CONNECT);
+	Channel(double ctrl_delay = BUS_CTRL_DELAY, double data_delay = BUS_DATA_DELAY, unsigned int max_connections = BUS_MAX_CONNECT);
 	~Channel(void);
 	enum status lock(double start_time, double duration, Event &event);
+	void unlock(double current_time);
 	enum status connect(void);
 	enum status disconnect(void);
 private:
-	void unlock(double current_time);
-	unsigned int table_size;
-	double * const lock_time;
-	double * const unlock_time;
-	unsigned int table_entries;
-	unsigned int selected_entry;
 	unsigned int num_connected;
 	unsigned int max_connections;
 	double ctrl_delay;
 	double data_delay;
+	std::map<double, double> busy;
 };
 
 /* Multi-channel bus comprised of Channel class objects
@@ -317,9 +539,10 @@ private:
 class Bus
 {
 public:
-	Bus(unsigned int num_channels = SSD_SIZE, double ctrl_delay = BUS_CTRL_DELAY, double data_delay = BUS_DATA_DELAY, unsigned int table_size = BUS_TABLE_SIZE, unsigned int max_connections = BUS_MAX_CONNECT);
+	Bus(unsigned int num_channels = SSD_SIZE, double ctrl_delay = BUS_CTRL_DELAY, double data_delay = BUS_DATA_DELAY, unsigned int max_connections = BUS_MAX_CONNECT);
 	~Bus(void);
 	enum status lock(unsigned int channel, double start_time, double duration, Event &event);
+	void unlock(double current_time);
 	enum status connect(unsigned int channel);
 	enum status disconnect(unsigned int channel);
 	Channel &get_channel(unsigned int channel);
@@ -328,28 +551,112 @@ private:
 	Channel * const channels;
 };
 
+/* Tournament tree over the wear of the children of a hardware unit (the
+ * blocks of a plane, the planes of a die, etc.).  Each child is keyed on the
+ * erases remaining of its least worn and most worn blocks.  Updating a child
+ * replays the matches on its path to the root in O(log n), and the least worn
+ * and most worn children are read from the root in constant time.  Ties go to
+ * the child with the lower index. */
+class Wear_index
+{
+public:
+	Wear_index(unsigned int size, unsigned long erases_remaining = BLOCK_ERASES);
+	~Wear_index(void);
+	void update(unsigned int child, unsigned long max_erases_remaining, unsigned long min_erases_remaining);
+	void update(unsigned int child, const Wear_index &child_index);
+	unsigned int get_least_worn(void) const;
+	unsigned int get_most_worn(void) const;
+	unsigned long get_max_erases_remaining(void) const;
+	unsigned long get_min_erases_remaining(void) const;
+private:
+	unsigned int winner(const unsigned int *tree, const unsigned long *key, unsigned int node, bool max) const;
+	unsigned int size;
+	unsigned long * const max_key;
+	unsigned long * const min_key;
+	unsigned int * const max_tree;
+	unsigned int * const min_tree;
+};
+
+/* Bucket index over the fully written blocks of a plane keyed by their
+ * number of valid pages, so the greedy garbage collection victim of a plane
+ * is found in constant time.  Blocks are added when their last page is
+ * written, rekeyed when pages are invalidated and dropped when erased. */
+class Victim_index
+{
+public:
+	Victim_index(unsigned int size, unsigned int max_key = BLOCK_SIZE);
+	~Victim_index(void);
+	void insert(unsigned int child, unsigned int key);
+	void remove(unsigned int child);
+	void update(unsigned int child, unsigned int key);
+	bool contains(unsigned int child) const;
+	unsigned int get_min(void) const;
+	unsigned int get_min_key(void) const;
+private:
+	void link(unsigned int child, unsigned int key);
+	void unlink(unsigned int child);
+	unsigned int size;
+	unsigned int max_key;
+	unsigned int min_key;
+	unsigned int * const key;
+	unsigned int * const next;
+	unsigned int * const prev;
+	unsigned int * const head;
+};
+
+/* Index of the cleaning candidates of a cleaning policy.  Candidates are kept
+ * in buckets by a small key, such as the pages cleaning them would copy, and
+ * each bucket is ordered on a second key, such as the time the candidate was
+ * filled or erased, with ties going to the lower candidate.  The first
+ * candidate of the lowest bucket is found in constant time and the first of
+ * every bucket in max_key + 1 steps, while adding, rekeying and removing a
+ * candidate take O(log n).  Candidates are numbered from 0 and the index
+ * grows to fit them. */
+class Policy_index
+{
+public:
+	Policy_index(unsigned int max_key = BLOCK_SIZE);
+	~Policy_index(void);
+	void insert(unsigned long child, unsigned int key, double order);
+	void remove(unsigned long child);
+	void update(unsigned long child, unsigned int key, double order);
+	bool contains(unsigned long child) const;
+	double get_order(unsigned long child) const;
+	bool get_min(unsigned long &child) const;
+	bool get_first(unsigned int key, unsigned long &child) const;
+private:
+	void link(unsigned long child, unsigned int key, double order);
+	void unlink(unsigned long child);
+	unsigned int max_key;
+	unsigned int min_key;
+	std::vector<unsigned int> key;
+	std::vector<double> order;
+	std::vector<std::set<std::pair<double, unsigned long> > > buckets;
+};
+
 /* The page is the lowest level data storage unit that is the size unit of
- * requests (events).  Pages maintain their state as events modify them. */
+ * requests (events).  Page states are packed PAGE_STATE_BITS per page into
+ * the words of the page state map owned by the parent Block, so a page has
+ * no storage of its own.  The Page class provides the operations on a packed
+ * page state map and the page read and write delays, which are taken from the
+ * global configuration. */
+#define PAGE_STATE_BITS 2
+#define PAGE_STATE_MASK 3UL
+#define PAGES_PER_WORD (sizeof(unsigned long) * 8 / PAGE_STATE_BITS)
 class Page 
 {
 public:
-	Page(const Block &parent, double read_delay = PAGE_READ_DELAY, double write_delay = PAGE_WRITE_DELAY);
-	~Page(void);
-	enum status _read(Event &event);
-	enum status _write(Event &event);
-	const Block &get_parent(void) const;
-	enum page_state get_state(void) const;
-	void set_state(enum page_state state);
-private:
-	enum page_state state;
-	const Block &parent;
-	double read_delay;
-	double write_delay;
-/* 	Address next_page; */
+	static enum status _read(enum page_state state, Event &event);
+	static enum status _write(enum page_state state, Event &event);
+	static enum page_state get_state(const unsigned long *map, unsigned int page);
+	static void set_state(unsigned long *map, unsigned int page, enum page_state state);
+	static unsigned int find_empty(const unsigned long *map, unsigned int start, unsigned int size);
+	static unsigned int get_map_words(unsigned int size);
 };
 
 /* The block is the data storage hardware unit where erases are implemented.
- * Blocks maintain wear statistics for the FTL. */
+ * Blocks maintain wear statistics for the FTL and a write pointer to their
+ * first empty page. */
 class Block 
 {
 public:
@@ -371,8 +678,9 @@ public:
 	void invalidate_page(unsigned int page);
 private:
 	unsigned int size;
-	Page * const data;
+	unsigned long * const data;
 	const Plane &parent;
+	unsigned int next_page;
 	unsigned int pages_valid;
 	unsigned int pages_invalid;
 	enum block_state state;
@@ -383,7 +691,9 @@ private:
 
 /* The plane is the data storage hardware unit that contains blocks.
  * Plane-level merges are implemented in the plane.  Planes maintain wear
- * statistics for the FTL. */
+ * statistics for the FTL.  Planes keep their free blocks in a wear index so
+ * that the next block written is the least worn free block, found in
+ * O(log n). */
 class Plane 
 {
 public:
@@ -397,18 +707,27 @@ public:
 	double get_last_erase_time(const Address &address) const;
 	unsigned long get_erases_remaining(const Address &address) const;
 	void get_least_worn(Address &address) const;
+	void get_most_worn(Address &address) const;
+	const Wear_index &get_wear_index(void) const;
 	unsigned int get_size(void) const;
 	enum page_state get_state(const Address &address) const;
 	void get_free_page(Address &address) const;
+	void get_free_block(Address &address) const;
 	unsigned int get_num_free(const Address &address) const;
 	unsigned int get_num_valid(const Address &address) const;
+	unsigned int get_victim(Address &address) const;
+	void invalidate_page(const Address &address);
 private:
-	void update_wear_stats(void);
+	void update_wear_stats(const Address &address);
 	enum status get_next_page(void);
+	void add_free_block(unsigned int block);
+	void remove_free_block(unsigned int block);
 	unsigned int size;
 	Block * const data;
 	const Die &parent;
-	unsigned int least_worn;
+	Wear_index wear;
+	Wear_index free_wear;
+	Victim_index victims;
 	unsigned long erases_remaining;
 	double last_erase_time;
 	double reg_read_delay;
@@ -418,7 +737,9 @@ private:
 };
 
 /* The die is the data storage hardware unit that contains planes and is a flash
- * chip.  Dies maintain wear statistics for the FTL. */
+ * chip.  Dies maintain wear statistics for the FTL.  A die runs one operation
+ * at a time: an operation waits until the die is free and keeps it busy until
+ * it finishes. */
 class Die 
 {
 public:
@@ -433,19 +754,27 @@ public:
 	double get_last_erase_time(const Address &address) const;
 	unsigned long get_erases_remaining(const Address &address) const;
 	void get_least_worn(Address &address) const;
+	void get_most_worn(Address &address) const;
+	const Wear_index &get_wear_index(void) const;
 	enum page_state get_state(const Address &address) const;
 	void get_free_page(Address &address) const;
+	void get_free_block(Address &address) const;
 	unsigned int get_num_free(const Address &address) const;
 	unsigned int get_num_valid(const Address &address) const;
+	unsigned int get_victim(Address &address) const;
+	void invalidate_page(const Address &address);
 private:
 	void update_wear_stats(const Address &address);
+	void wait(Event &event) const;
+	void hold(const Event &event);
 	unsigned int size;
 	Plane * const data;
 	const Package &parent;
 	Channel &channel;
-	unsigned int least_worn;
+	Wear_index wear;
 	unsigned long erases_remaining;
 	double last_erase_time;
+	double busy_until;
 };
 
 /* The package is the highest level data storage hardware unit.  While the
@@ -465,16 +794,21 @@ public:
 	double get_last_erase_time (const Address &address) const;
 	unsigned long get_erases_remaining (const Address &address) const;
 	void get_least_worn (Address &address) const;
+	void get_most_worn (Address &address) const;
+	const Wear_index &get_wear_index(void) const;
 	enum page_state get_state(const Address &address) const;
 	void get_free_page(Address &address) const;
+	void get_free_block(Address &address) const;
 	unsigned int get_num_free(const Address &address) const;
 	unsigned int get_num_valid(const Address &address) const;
+	unsigned int get_victim(Address &address) const;
+	void invalidate_page(const Address &address);
 private:
 	void update_wear_stats (const Address &address);
 	unsigned int size;
 	Die * const data;
 	const Ssd &parent;
-	unsigned int least_worn;
+	Wear_index wear;
 	unsigned long erases_remaining;
 	double last_erase_time;
 };
@@ -484,18 +818,74 @@ private:
 class Garbage_collector 
 {
 private:
-	void perform_cleaning(unsigned long logical_address,unsigned int logical_block_num);
-	void merge_data_and_log_block(unsigned long logical_address,unsigned int logical_block_num);
-	void erase_data_and_log_block(unsigned long logical_address,unsigned int logical_block_num);
-	void copy_cleaning_block_to_data_block(unsigned long logical_address);
-	void erase_cleaning_block();
+	/* A merge in progress: the data block, the die it was on, its log block
+	 * or NULL, whether it is a switch or partial merge, the cleaning block
+	 * of a full merge, whether the log block goes back to the free pool, the
+	 * next page offset to copy, whether the data block was remapped and the
+	 * number of blocks erased */
+	struct Merge
+	{
+		unsigned int block;
+		unsigned int die;
+		LOG_BLOCK *log_block;
+		bool in_order;
+		unsigned int cleaning_block;
+		bool free_log_block;
+		unsigned int page;
+		bool remapped;
+		unsigned int erases;
+	};
+	void perform_cleaning(unsigned int logical_block_num);
+	bool start_merge(unsigned int logical_block_num, bool free_log_block);
+	unsigned int start_victim_merges(Event &event, unsigned int target, unsigned int logical_block_num, unsigned int max_merges = SSD_SIZE * PACKAGE_SIZE);
+	bool merge_step(Merge &merge, unsigned int max_pages);
+	void step_merges(unsigned int max_pages);
+	void finish_merge(void);
+	bool finish_merge(unsigned int logical_block_num);
+	LOG_BLOCK *get_log_block(unsigned int logical_block_num);
+	unsigned int select_cleaning_block(unsigned int logical_block_num, LOG_BLOCK *log_block);
+	bool check_log_block_in_order(unsigned int logical_block_num, LOG_BLOCK *log_block);
+	bool check_page_empty_log_block_full(LOG_BLOCK *log_block);
+	LOG_BLOCK *select_victim(Event &event, enum GC_POLICY policy);
+	enum status merge_victim(enum GC_POLICY policy);
+	void reclaim_oldest_random_log_block(void);
+	unsigned int get_merge_cost(unsigned int logical_block_num, LOG_BLOCK *log_block);
+	void copy_latest_page(unsigned long logical_address, const Address &target);
+	void remap_data_block(unsigned int logical_block_num, Ppa &block);
+	void erase_block(const Ppa &block);
+	void release_log_block(unsigned int logical_block_num, LOG_BLOCK *log_block);
+	void erase_log_block(LOG_BLOCK *log_block);
+	void add_event(enum event_type type, unsigned long logical_address, const Address &address, const Address &target = Address());
+	void issue_events(void);
+	/* Request the cleaning is done for, which is charged with its time */
+	Event *request;
+	/* Merges in progress, at most one per die of their data blocks */
+	std::vector<Merge> merges;
+	/* Victims passed over by start_victim_merges() */
+	std::vector<LOG_BLOCK *> passed_victims;
+	/* BAST log blocks that can be merged, by log block number, for the
+	 * cleaning policy, see Garbage_collector::index_log_block() */
+	Policy_index victims;
 
 public:
 	Garbage_collector(Ftl &FTL, FILE *log_file);
 	~Garbage_collector(void);
 	enum status collect(Event &event, enum GC_POLICY policy);
+	unsigned int collect_idle(Event &event, double idle_time, float watermark);
+	unsigned int collect_idle_step(Event &event, float watermark);
+	void collect_throttled(Event &event, double hold, float watermark);
+	void collect_step(Event &event);
+	void map_log_block(LOG_BLOCK *log_block);
+	void index_log_block(LOG_BLOCK *log_block);
+	enum status migrate(Event &event, const Address &block);
+	void merge_sequential_log_block(Event &event);
+	void reclaim_random_log_block(Event &event);
   FILE *log_file;
   Ftl &ftl;
+  /* Number of merges of each kind performed */
+  unsigned long num_switch_merges;
+  unsigned long num_partial_merges;
+  unsigned long num_full_merges;
 };
 
 class Wear_leveler 
@@ -503,9 +893,129 @@ class Wear_leveler
 public:
 	Wear_leveler(Ftl &FTL, FILE *log_file);
 	~Wear_leveler(void);
-	enum status level( Event &event );
+	unsigned int level(Event &event, double idle_time);
+	enum status level_step(Event &event);
+	void add_free_log_block(LOG_BLOCK *log_block);
+	LOG_BLOCK *get_free_log_block(void);
+	void swap_free_block(Ppa &block);
   FILE *log_file;
   Ftl &ftl;
+  /* Number of blocks whose data was moved for static wear leveling */
+  unsigned long num_migrations;
+private:
+  /* Time the moves can still take and the time it was last topped up at */
+  double budget;
+  double budget_time;
+};
+
+/* Cached mapping table for DFTL.  Holds up to size logical to physical page
+ * mappings in least recently used order, each with a dirty flag that is set
+ * when the mapping changed since its translation page was last written.  Slots
+ * are linked in arrays and found through a hash index on the logical page. */
+class Mapping_cache
+{
+public:
+	Mapping_cache(unsigned int size);
+	~Mapping_cache(void);
+	bool lookup(unsigned long logical_page, unsigned int &physical_page);
+	bool is_full(void) const;
+	void insert(unsigned long logical_page, unsigned int physical_page, bool dirty);
+	void update(unsigned long logical_page, unsigned int physical_page);
+	void get_lru(unsigned long &logical_page, bool &dirty) const;
+	void evict(void);
+	bool clean(unsigned long logical_page, unsigned int &physical_page);
+private:
+	void unlink(unsigned int slot);
+	void push_front(unsigned int slot);
+	unsigned int size;
+	unsigned int used;
+	unsigned int head;
+	unsigned int tail;
+	unsigned long * const logical;
+	unsigned int * const physical;
+	bool * const dirty;
+	unsigned int * const next;
+	unsigned int * const prev;
+	std::unordered_map<unsigned long, unsigned int> index;
+};
+
+/* Page-mapped FTL selected with FTL_IMPLEMENTATION.  Every logical page can
+ * live on any physical page.  Physical page numbers use the same layout as
+ * logical addresses (see Geometry) and a P2L array holds the owner of each
+ * physical page for cleaning.  Writes go out of place to the write frontier
+ * of the next plane in round-robin order.  When the drive runs short of free
+ * blocks, a full block picked with SELECTED_GC_POLICY is cleaned by
+ * relocating its valid pages and erasing it.
+ *
+ * With PAGE_MAPPED the whole L2P table is a flat array in controller RAM.
+ * With DFTL the L2P table is kept in translation pages on flash, found
+ * through a global translation directory, and only MAP_CACHE_SIZE entries
+ * are cached in RAM.  Cache misses read translation pages and evicting a
+ * dirty entry writes its translation page back, and both are charged to the
+ * request that caused them. */
+class Page_ftl
+{
+public:
+	Page_ftl(Ftl &ftl, FILE *log_file);
+	~Page_ftl(void);
+	enum status translate(Event &event);
+	unsigned int collect_idle(Event &event, double idle_time, float watermark);
+	unsigned int collect_idle_step(Event &event, float watermark);
+	void collect_throttled(Event &event, double hold, float watermark);
+	double get_free_reserve(void) const;
+	enum status migrate(Event &event, const Address &block);
+private:
+	enum status read(Event &event);
+	enum status write(Event &event);
+	unsigned int select_stream(unsigned long logical_page);
+	unsigned int select_relocation_stream(unsigned long owner);
+	unsigned int get_heat(unsigned long logical_page);
+	enum status allocate(Address &address, unsigned int stream);
+	enum status allocate_plane(Address &address, unsigned int stream);
+	enum status take_page(Address &address, unsigned int stream);
+	unsigned long select_victim(Event &event);
+	enum status collect(Event &event);
+	enum status start_cleaning(Event &event);
+	enum status clean_step(Event &event, unsigned int max_pages);
+	enum status relocate(Event &event, unsigned int owner, const Address &source, Address &target);
+	enum status issue(Event &event, enum event_type type, unsigned long logical_address, const Address &address);
+	enum status get_mapping(Event &event, unsigned long logical_page, unsigned int &physical_page);
+	enum status set_mapping(Event &event, unsigned long logical_page, unsigned int physical_page);
+	enum status write_translation_page(Event &event, unsigned long translation_page);
+	void map_physical(unsigned long owner, unsigned int old_page, unsigned int new_page);
+	void index_victim(unsigned long block);
+	Ftl &ftl;
+	FILE *log_file;
+	unsigned long num_logical_pages;
+	unsigned long num_translation_pages;
+	unsigned long free_blocks;
+	unsigned int num_planes;
+	unsigned int next_plane;
+	unsigned int * const l2p;
+	unsigned int * const p2l;
+	unsigned int * const block_valid;
+	unsigned int * const block_written;
+	unsigned long * const block_filled;
+	unsigned long * const block_used;
+	unsigned long num_updates;
+	/* full blocks for the cleaning policies other than GREEDY, see
+	 * Page_ftl::index_victim() */
+	Policy_index victims;
+	/* block being cleaned, the number of blocks if none, and the next page
+	 * of it to relocate */
+	unsigned long victim;
+	unsigned long victim_page;
+	Mapping_cache * const cache;
+	unsigned int * const gtd;
+	unsigned int ** const translation_pages;
+	/* with STREAM_SEPARATION, the next page of the open block of each stream
+	 * of each plane, and the decaying update count of each logical page with
+	 * the low byte of the period it was last brought up to date in */
+	unsigned int * const stream_page;
+	unsigned char * const heat;
+	unsigned char * const heat_period;
+	unsigned long period;
+	unsigned long period_writes;
 };
 
 /* Ftl class has some completed functions that get info from lower-level
@@ -517,6 +1027,9 @@ class Ftl
 /* -----------Declare FTL data structures used in ssd_user.cpp------------- */
 private:
 
+/* The garbage collector merges the log blocks */
+friend class Garbage_collector;
+
 
 /* -------------------------Globals ----------------------------------------*/
 
@@ -532,8 +1045,19 @@ unsigned int num_blocks_log_reservation;
 bool check_log_block_mapped_data_block(unsigned int logical_block_num);
 /* Check if an empty page exists in a log block */
 unsigned int check_page_empty_log_block(unsigned int logical_block_num);
+unsigned int check_page_empty_log_block(LOG_BLOCK *log_block);
+/* Create an empty log block */
+LOG_BLOCK *create_log_block(const Address &block);
+/* Mark every page of a log block empty */
+void reset_log_block(LOG_BLOCK *log_block);
+/* Write a page at the append cursor of a log block */
+unsigned int append_log_block(LOG_BLOCK *log_block, int entry, unsigned int page_offset);
 /* Write event */
 enum status write_event(Event &event, Address* addr_allocate);
+/* Write event for FAST */
+enum status fast_write_event(Event &event, Address* addr_allocate);
+/* Get a log block from the free pool for FAST */
+LOG_BLOCK *get_free_log_block(Event &event);
 /* Read event */
 enum status read_event(Event &event, Address* addr_allocate);
 
@@ -543,28 +1067,50 @@ public:
 	enum status read(Event &event);
 	enum status write(Event &event);
   enum status garbage_collect(Event &event);
+	unsigned int collect_idle(Event &event, double idle_time);
+	unsigned int collect_idle_step(Event &event);
+	double get_free_reserve(void) const;
+	void throttle(Event &event);
   FILE *log_file;
   enum status translate( Event &event );
 	enum status erase(Event &event);
 	enum status merge(Event &event);
 	unsigned long get_erases_remaining(const Address &address) const;
 	void get_least_worn(Address &address) const;
+	void get_most_worn(Address &address) const;
 	enum page_state get_state(const Address &address) const;
+	void get_free_page(Address &address) const;
+	void get_free_block(Address &address) const;
+	unsigned int get_num_free(const Address &address) const;
+	unsigned int get_victim(Address &address) const;
+	void invalidate_page(const Address &address);
+	double get_last_erase_time(const Address &address) const;
     void init_ftl_user();
 	Controller &controller;
 	Garbage_collector garbage;
 	Wear_leveler wear;
 
-	/* -------------------Map for storing thr list of log blocks ---------------*/
+	/* events of the internal requests of the garbage collector, one list per
+	 * die */
+	Event_pool event_pool;
 
-std::map<unsigned long, LOG_BLOCK*> log_block_map;
+	/* page-mapped FTL, NULL unless selected by FTL_IMPLEMENTATION */
+	Page_ftl *page_ftl;
+
+	/* -------------------Directory of the log blocks ---------------*/
+
+/* Log block mapped to each data block, NULL if there is none */
+LOG_BLOCK **log_block_map;
+
+/* Every log block, in the order they were created */
+std::vector<LOG_BLOCK*> log_blocks;
+
+/* Number of log blocks mapped and written so far */
+unsigned long log_block_clock;
 
 /* Pointer to an array which stores the information about page states */
 bool *page_status;
 
- /* Cleaning block logical address */
-unsigned long cleaning_block_logical_addr;   
-
 /* Numbe rof blocks for SSD actual capacity */
 unsigned int num_blocks_available;     
 
@@ -572,16 +1118,44 @@ unsigned int num_blocks_available;
  unsigned int check_page_exists_log_block(unsigned int logical_block_number,
 	                                       int page_offset);
 
- unsigned int package_number;
- unsigned int dies_number;
- unsigned int plane_number;
- unsigned int block_number;
- unsigned int page_number;
+ /* Get the page of the data block a logical page belongs to */
+ void get_data_page(unsigned long logical_address, Address &address);
+
+ /* Mark the latest copy of a page stale before it is rewritten */
+ void invalidate_latest_page(unsigned long logical_address);
+
+ /* Find the latest copy of a logical page in the log blocks */
+ bool find_log_page(unsigned long logical_address, Address &address);
 
- unsigned int cleaning_package_num;
- unsigned int cleaning_dies_num;
- unsigned int cleaning_plane_num;
- unsigned int cleaning_block_num;
+ /* ------------------------FAST log blocks--------------------------------*/
+
+ /* Sequential log block, NULL if no logical block is being rewritten
+  * sequentially */
+ LOG_BLOCK *sequential_log_block;
+
+ /* Random log blocks shared by all logical blocks, oldest first */
+ std::deque<LOG_BLOCK*> random_log_blocks;
+
+ /* Erased log blocks ready to be used, keyed on their erases remaining so
+  * that the least worn comes first */
+ std::multimap<unsigned long, LOG_BLOCK*, std::greater<unsigned long> > free_log_blocks;
+
+ /* Physical page of the latest copy of each logical page in the log blocks,
+  * invalid if there is none */
+ Ppa *log_page_map;
+
+ /* Physical data block of each logical block */
+ Ppa *data_block_map;
+
+ /* Logical block held by each physical block, num_blocks_available if it
+  * is not a data block */
+ unsigned int *block_owner;
+
+ /* Physical data block of the request being translated */
+ Ppa data_block;
+
+ /* Physical cleaning blocks, erased and ready for full merges */
+ std::vector<Ppa> cleaning_blocks;
 
 };
 
@@ -611,35 +1185,62 @@ private:
 class Controller 
 {
 public:
+	friend class Ftl;
 	Controller(Ssd &parent, FILE *log_file);
 	~Controller(void);
 	enum status event_arrive(Event &event);
   FILE *log_file;
   enum status issue(Event &event_list);
+	unsigned int collect_idle(Event &event, double idle_time);
+	unsigned int collect_idle_step(Event &event);
 private:
+	enum status lock_bus(Event &event, double duration);
 	unsigned long get_erases_remaining(const Address &address) const;
 	void get_least_worn(Address &address) const;
+	void get_most_worn(Address &address) const;
 	double get_last_erase_time(const Address &address) const;
 	enum page_state get_state(const Address &address) const;
 	void get_free_page(Address &address) const;
+	void get_free_block(Address &address) const;
 	unsigned int get_num_free(const Address &address) const;
 	unsigned int get_num_valid(const Address &address) const;
+	unsigned int get_victim(Address &address) const;
+	void invalidate_page(const Address &address);
 	Ssd &ssd;
 	Ftl ftl;
 };
 
 /* The SSD is the single main object that will be created to simulate a real
  * SSD.  Creating a SSD causes all other objects in the SSD to be created.  The
- * event_arrive method is where events will arrive from DiskSim. */
+ * event_arrive method is where events will arrive from DiskSim.  Hosts that
+ * keep several requests in flight submit them instead, run the simulation
+ * and collect the completions as they finish. */
 class Ssd 
 {
 public:
 	Ssd (FILE *log_file, unsigned int ssd_size = SSD_SIZE);
 	~Ssd(void);
 	double event_arrive(enum event_type type, unsigned long logical_address, unsigned int size, double start_time, int *status, Address &address);
+	unsigned long submit(enum event_type type, unsigned long logical_address, unsigned int size, double arrive_time);
+	void run(double until);
+	void run(void);
+	bool get_completion(Request &request);
+	double get_time(void) const;
+	double get_next_time(void) const;
   unsigned long get_pages_per_block();
   unsigned long get_total_erases_performed();
+  unsigned long get_total_merges_performed();
   unsigned long get_total_writes_observed();
+  unsigned long get_total_host_writes();
+  double get_write_amplification();
+  unsigned long get_block_erase_count(Address address);
+  double get_idle_gc_time();
+  double get_hidden_gc_time();
+  unsigned long get_idle_gc_blocks();
+  double get_last_bus_wait_time();
+  double get_total_bus_wait_time();
+  double get_latency_percentile(enum event_type type, double percentile);
+  void print_latency_histogram(FILE *stream);
   void write_ref_map(unsigned long lba, Address pba);
   bool is_valid(unsigned long lba, Address validate_with);
   unsigned long get_max_num_erases();
@@ -653,26 +1254,90 @@ private:
 	unsigned long get_erases_remaining(const Address &address) const;
 	void update_wear_stats(const Address &address);
 	void get_least_worn(Address &address) const;
+	void get_most_worn(Address &address) const;
 	double get_last_erase_time(const Address &address) const;	
 	Package &get_data(void);
 	enum page_state get_state(const Address &address) const;
 	void get_free_page(Address &address) const;
+	void get_free_block(Address &address) const;
 	unsigned int get_num_free(const Address &address) const;
 	unsigned int get_num_valid(const Address &address) const;
+	unsigned int get_victim(Address &address) const;
+	void invalidate_page(const Address &address);
+	double collect_idle(double start_time);
+	void account_idle_gc(const Event &event, unsigned int cleaned);
+	enum status service(Event &event);
+	void arrive(unsigned long id);
+	void complete(unsigned long id);
+	void collect_step(unsigned long tag);
 	unsigned int size;
 	Controller controller;
 	Ram ram;
 	Bus bus;
 	Package * const data;
 	unsigned long erases_remaining;
-	unsigned long least_worn;
+	Wear_index wear;
 	double last_erase_time;
   unsigned long total_erases_performed;
+  unsigned long total_merges_performed;
   unsigned long total_writes_observed;
-  std::map<unsigned long, Address> ref_map;
+  unsigned long total_host_writes;
+  double last_completion_time;
+  double idle_gc_time;
+  double hidden_gc_time;
+  double idle_gc_until;
+  unsigned long idle_gc_blocks;
+  double last_bus_wait_time;
+  double total_bus_wait_time;
+  Scheduler scheduler;
+  std::unordered_map<unsigned long, Request> requests;
+  std::deque<Request> completions;
+  unsigned long next_request_id;
+  unsigned long num_arrived;
+  unsigned long num_active;
+  std::vector<double> read_latencies;
+  std::vector<double> write_latencies;
+  std::map<unsigned long, Ppa> ref_map;
   unsigned long max_num_erases;
 };
 
+/* Host interface of submission and completion queue pairs in front of the
+ * drive, as NVMe and NCQ hosts drive it.  The host submits commands to a
+ * queue, which holds at most queue_depth of them outstanding.  When the
+ * simulation reaches the time of a command, the interface fetches the
+ * commands that are due from the submission queues in arbitration order and
+ * passes them to the drive.  Completions are posted to the completion queue
+ * of the pair in the order the commands finish, which need not be the order
+ * they were submitted in. */
+class Host_interface
+{
+public:
+	Host_interface(Ssd &ssd, unsigned int num_queues = HOST_NUM_QUEUES, unsigned int queue_depth = HOST_QUEUE_DEPTH);
+	~Host_interface(void);
+	enum status submit(unsigned int queue, enum event_type type, unsigned long logical_address, unsigned int size, double time, unsigned long &id);
+	void set_weight(unsigned int queue, unsigned int weight);
+	void run(double until);
+	void run(void);
+	bool step(void);
+	bool get_completion(unsigned int queue, Request &request);
+	unsigned int get_outstanding(unsigned int queue) const;
+	double get_time(void) const;
+private:
+	bool get_next_fetch(double &time) const;
+	void fetch(double time);
+	void post(void);
+	Ssd &ssd;
+	const unsigned int num_queues;
+	const unsigned int queue_depth;
+	std::vector<std::deque<Request> > submission;
+	std::vector<std::deque<Request> > completion;
+	std::vector<unsigned int> outstanding;
+	std::vector<unsigned int> weight;
+	std::unordered_map<unsigned long, std::pair<unsigned int, unsigned long> > fetched;
+	unsigned int next_queue;
+	unsigned long next_id;
+};
+
 } /* end namespace ssd */
 
 #endif
@@ -26,6 +26,7 @@
 #include <new>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 #include "ssd.h"
 
 using namespace ssd;
@@ -33,10 +34,13 @@ using namespace ssd;
 Block::Block(const Plane &parent, unsigned int block_size, unsigned long erases_remaining, double erase_delay):
 	size(block_size),
 
-	/* use a const pointer (Page * const data) to use as an array
-	 * but like a reference, we cannot reseat the pointer */
-	data((Page *) malloc(block_size * sizeof(Page))),
+	/* use a const pointer (unsigned long * const data) to use as an array
+	 * but like a reference, we cannot reseat the pointer
+	 * page states are packed into the words of the array and calloc leaves
+	 * every page EMPTY */
+	data((unsigned long *) calloc(Page::get_map_words(block_size), sizeof(unsigned long))),
 	parent(parent),
+	next_page(0),
 	pages_valid(0),
 	pages_invalid(0),
 	state(FREE),
@@ -51,54 +55,49 @@ Block::Block(const Plane &parent, unsigned int block_size, unsigned long erases_
 	last_erase_time(0.0),
 	erase_delay(erase_delay)
 {
-	unsigned int i;
-
 	if(erase_delay < 0.0)
 	{
 		fprintf(stderr, "Block warning: %s: constructor received negative erase delay value\n\tsetting erase delay to 0.0\n", __func__);
 		erase_delay = 0.0;
 	}
 
-	/* new cannot initialize an array with constructor args so
-	 * 	malloc the array
-	 * 	then use placement new to call the constructor for each element
-	 * chose an array over container class so we don't have to rely on anything
+	/* chose an array over container class so we don't have to rely on anything
 	 * 	i.e. STL's std::vector */
 	/* array allocated in initializer list:
-	 * data = (Page *) malloc(size * sizeof(Page)); */
+	 * data = (unsigned long *) calloc(Page::get_map_words(size), sizeof(unsigned long)); */
 	if(data == NULL){
 		fprintf(stderr, "Block error: %s: constructor unable to allocate Page data\n", __func__);
 		exit(MEM_ERR);
 	}
-	for(i = 0; i < size; i++)
-		(void) new (&data[i]) Page(*this, PAGE_READ_DELAY, PAGE_WRITE_DELAY);
 	return;
 }
 
 Block::~Block(void)
 {
 	assert(data != NULL);
-	unsigned int i;
-	/* call destructor for each Page array element
-	 * since we used malloc and placement new */
-	for(i = 0; i < size; i++)
-		data[i].~Page();
 	free(data);
 	return;
 }
 
 enum status Block::read(Event &event)
 {
-	assert(data != NULL);
-	return data[event.get_address().page]._read(event);
+	assert(data != NULL && event.get_address().page < size);
+	return Page::_read(Page::get_state(data, event.get_address().page), event);
 }
 
 enum status Block::write(Event &event)
 {
-	assert(data != NULL);
-	enum status ret = data[event.get_address().page]._write(event);
+	assert(data != NULL && event.get_address().page < size);
+	enum status ret = Page::_write(Page::get_state(data, event.get_address().page), event);
 	if(ret == SUCCESS)
 	{
+		Page::set_state(data, event.get_address().page, VALID);
+
+		/* advance the write pointer past pages that are no longer empty
+		 * the pointer only moves forward between erases, so this is constant
+		 * time amortized over the writes to the block */
+		if(event.get_address().page == next_page)
+			next_page = Page::find_empty(data, next_page + 1, size);
 		pages_valid++;
 		state = ACTIVE;
 	}
@@ -112,7 +111,6 @@ enum status Block::write(Event &event)
 enum status Block::_erase(Event &event)
 {
 	assert(data != NULL && erase_delay >= 0.0);
-	unsigned int i;
 
 	if(erases_remaining < 1)
 	{
@@ -120,8 +118,9 @@ enum status Block::_erase(Event &event)
 		return FAILURE;
 	}
 
-	for(i = 0; i < size; i++)
-		data[i].set_state(EMPTY);
+	/* EMPTY is stored as 0 */
+	memset(data, 0, Page::get_map_words(size) * sizeof(unsigned long));
+	next_page = 0;
 	event.incr_time_taken(erase_delay);
 	last_erase_time = event.get_start_time() + event.get_time_taken();
 	erases_remaining--;
@@ -155,13 +154,13 @@ enum block_state Block::get_state(void) const
 enum page_state Block::get_state(unsigned int page) const
 {
 	assert(data != NULL && page < size);
-	return data[page].get_state();
+	return Page::get_state(data, page);
 }
 
 enum page_state Block::get_state(const Address &address) const
 {
    assert(data != NULL && address.page < size && address.valid >= BLOCK);
-   return data[address.page].get_state();
+   return Page::get_state(data, address.page);
 }
 
 double Block::get_last_erase_time(void) const
@@ -182,7 +181,12 @@ unsigned int Block::get_size(void) const
 void Block::invalidate_page(unsigned int page)
 {
 	assert(page < size);
-	data[page].set_state(INVALID);
+
+	/* only a valid page becomes invalid */
+	if(Page::get_state(data, page) != VALID)
+		return;
+	Page::set_state(data, page, INVALID);
+	pages_valid--;
 	pages_invalid++;
 
 	/* update block state */
@@ -197,19 +201,16 @@ void Block::invalidate_page(unsigned int page)
 }
 
 /* method to find the next usable (empty) page in this block
- * method is called by write and erase methods and in Plane::get_next_page() */
+ * the write pointer is maintained by the write and erase methods so this
+ * method runs in constant time
+ * method is called in Plane::write() and Plane::get_next_page() */
 enum status Block::get_next_page(Address &address) const
 {
-	unsigned int i;
-
-	for(i = 0; i < size; i++)
+	if(next_page < size)
 	{
-		if(data[i].get_state() == EMPTY)
-		{
-			address.page = i;
-			address.valid = PAGE;
-			return SUCCESS;
-		}
+		address.page = next_page;
+		address.valid = PAGE;
+		return SUCCESS;
 	}
 	return FAILURE;
 }
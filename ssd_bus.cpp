@@ -38,17 +38,16 @@ using namespace ssd;
 
 /* a multi-channel bus: multiple independent channels that operate in parallel
  * allocate channels and pass parameters to channels via the lock method
- * the table size is synonymous to the queue size for each separate channel
+ * each separate channel queues any number of transmissions
  * it is not necessary to use the max connections properly, but it is provided
  * 	to help ensure correctness */
-Bus::Bus(unsigned int num_channels, double ctrl_delay, double data_delay, unsigned int table_size, unsigned int max_connections):
+Bus::Bus(unsigned int num_channels, double ctrl_delay, double data_delay, unsigned int max_connections):
 	num_channels(num_channels),
 
 	/* use a const pointer (Channel * const channels) to use as an array
 	 * but like a reference, we cannot reseat the pointer */
 	channels((Channel *) malloc(num_channels * sizeof(Channel)))
 {
-	assert(table_size > 0);
 	if(ctrl_delay < 0.0){
 		fprintf(stderr, "Bus warning: %s: constructor received negative control delay value\n\tsetting control delay to 0.0\n", __func__);
 		ctrl_delay = 0.0;
@@ -73,7 +72,7 @@ Bus::Bus(unsigned int num_channels, double ctrl_delay, double data_delay, unsign
 		exit(MEM_ERR);
 	}
 	for(i = 0; i < num_channels; i++)
-		(void) new (&channels[i]) Channel(ctrl_delay, data_delay, table_size, max_connections);
+		(void) new (&channels[i]) Channel(ctrl_delay, data_delay, max_connections);
 
 	return;
 }
@@ -113,7 +112,6 @@ enum status Bus::disconnect(unsigned int channel)
  * updates event with bus delay and bus wait time if there is wait time
  * channel will automatically unlock after event is finished using bus
  * assumes event is sent across channel as soon as bus is available
- * event may fail if channel is saturated so check return value
  */
 enum status Bus::lock(unsigned int channel, double start_time, double duration, Event &event)
 {
@@ -121,6 +119,16 @@ enum status Bus::lock(unsigned int channel, double start_time, double duration,
 	return channels[channel].lock(start_time, duration, event);
 }
 
+/* remove the intervals of every channel that finished by current_time */
+void Bus::unlock(double current_time)
+{
+	assert(channels != NULL);
+	unsigned int i;
+	for(i = 0; i < num_channels; i++)
+		channels[i].unlock(current_time);
+	return;
+}
+
 Channel &Bus::get_channel(unsigned int channel)
 {
 	assert(channels != NULL && channel < num_channels);
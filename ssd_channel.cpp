@@ -24,11 +24,12 @@
  * Simulate multiple devices on 1 bus channel with variable bus transmission
  * durations for data and control delays with the Channel class.  Provide the 
  * delay times to send a control signal or 1 page of data across the bus
- * channel, the bus table size for the maximum number channel transmissions that
- * can be queued, and the maximum number of devices that can connect to the bus.
- * To elaborate, the table size is the size of the channel scheduling table that
- * holds start and finish times of events that have not yet completed in order
- * to determine where the next event can be scheduled for bus utilization.
+ * channel and the maximum number of devices that can connect to the bus.
+ * The channel keeps the busy intervals of transmissions that have not yet
+ * completed in an ordered map from start to finish time to determine where
+ * the next event can be scheduled for bus utilization.  Touching intervals
+ * are merged, so a backlog of back-to-back transmissions is a single
+ * interval and the search for a gap only steps over gaps that are too short.
  */
 
 #include <new>
@@ -42,23 +43,15 @@ using namespace ssd;
  * simulates control and data
  * enable signals are implicitly simulated by the sender locking the bus
  * 	then sending to multiple devices
- * the table size is synonymous to the queue size for the channel
+ * the channel queues any number of transmissions
  * it is not necessary to use the max connections properly, but it is provided
  * 	to help ensure correctness */
-Channel::Channel(double ctrl_delay, double data_delay, unsigned int table_size, unsigned int max_connections):
-	table_size(table_size),
-
-	/* use a const pointer (double * const) for the scheduling table arrays
-	 * like a reference, we cannot reseat the pointer */
-	lock_time(new double[table_size]),
-	unlock_time(new double[table_size]),
-
-	table_entries(0),
-	selected_entry(0),
+Channel::Channel(double ctrl_delay, double data_delay, unsigned int max_connections):
 	num_connected(0),
 	max_connections(max_connections),
 	ctrl_delay(ctrl_delay),
-	data_delay(data_delay)
+	data_delay(data_delay),
+	busy()
 {
 	if(ctrl_delay < 0.0){
 		fprintf(stderr, "Bus channel warning: %s: constructor received negative control delay value\n\tsetting control delay to 0.0\n", __func__);
@@ -68,31 +61,12 @@ Channel::Channel(double ctrl_delay, double data_delay, unsigned int table_size,
 		fprintf(stderr, "Bus channel warning: %s: constructor received negative data delay value\n\tsetting data delay to 0.0\n", __func__);
 		data_delay = 0.0;
 	}
-
-	unsigned int i;
-
-	/* initialize scheduling tables
-	 * arrays allocated in initializer list */
-	if(lock_time == NULL || unlock_time == NULL)
-	{
-		fprintf(stderr, "Bus channel error: %s: constructor unable to allocate channel scheduling tables\n", __func__);
-		exit(MEM_ERR);
-	}
-	for(i = 0; i < table_size; i++)
-	{
-		lock_time[i] = BUS_CHANNEL_FREE_FLAG;
-		unlock_time[i] = BUS_CHANNEL_FREE_FLAG;
-	}
-
 	return;
 }
 
 /* free allocated bus channel state space */
 Channel::~Channel(void)
 {
-	assert(lock_time != NULL && unlock_time != NULL);
-	delete[] lock_time;
-	delete[] unlock_time;
 	if(num_connected > 0)
 		fprintf(stderr, "Bus channel warning: %s: %d connected devices when bus channel terminated\n", __func__, num_connected);
 	return;
@@ -134,85 +108,54 @@ enum status Channel::disconnect(void)
 /* lock bus channel for event
  * updates event with bus delay and bus wait time if there is wait time
  * bus will automatically unlock after event is finished using bus
- * event is sent across bus as soon as bus channel is available
- * event may fail if bus channel is saturated so check return value
+ * event is sent across bus in the first gap long enough for it that starts
+ * 	at or after start_time
+ * finding the gap takes O(log n) plus a step for each shorter gap after
+ * 	start_time, and there is no limit on the number of intervals
  */
 enum status Channel::lock(double start_time, double duration, Event &event)
 {
-/* TODO: Recombine assert statements */
-	assert(lock_time != NULL && unlock_time != NULL);assert(num_connected <= max_connections);assert(ctrl_delay >= 0.0);assert(data_delay >= 0.0);assert(start_time >= 0.0);assert(duration >= 0.0);
-
-	#ifndef NDEBUG
-		unsigned int j;
-		printf("Table entries before unlock()\n");
-		for(j = 0; j < table_size; j++)
-			printf("%lf, %lf\n", lock_time[j], unlock_time[j]);
-		printf("Press ENTER to continue...");
-		fflush(stdout);
-		getchar();
-	#endif
-
-	/* free up any table slots and sort existing ones */
-	unlock(start_time);
-
-	#ifndef NDEBUG
-		printf("Table entries after unlock()\n");
-		for(j = 0; j < table_size; j++)
-			printf("%lf, %lf\n", lock_time[j], unlock_time[j]);
-		printf("Press ENTER to continue...");
-		fflush(stdout);
-		getchar();
-	#endif
-
-	/* give up if no free table slots */
-	if(table_entries >= table_size)
-		return FAILURE;
-	
-	unsigned int i = 0;
-	double sched_time = BUS_CHANNEL_FREE_FLAG;
-
-	/* just schedule if table is empty */
-	if(table_entries == 0)
-		sched_time = start_time;
+	assert(num_connected <= max_connections);
+	assert(ctrl_delay >= 0.0 && data_delay >= 0.0);
+	assert(start_time >= 0.0 && duration >= 0.0);
+
+	/* start with the interval holding the bus at start_time, if any, then
+	 * step over the intervals that begin too soon after the bus is free */
+	double sched_time = start_time;
+	std::map<double, double>::iterator next = busy.upper_bound(start_time);
+	if(next != busy.begin())
+	{
+		std::map<double, double>::iterator prev = next;
+		prev--;
+		if(prev -> second > sched_time)
+			sched_time = prev -> second;
+	}
+	while(next != busy.end() && next -> first - sched_time < duration)
+	{
+		if(next -> second > sched_time)
+			sched_time = next -> second;
+		next++;
+	}
 
-	/* check if can schedule before or in between before just scheduling
-	 * after all other events */
-	else
+	/* record the interval, merging it with the ones it touches */
+	double finish_time = sched_time + duration;
+	if(next != busy.end() && next -> first == finish_time)
 	{
-		/* skip over empty table entries
-		 * empty table entries will be first from sorting (in unlock method)
-		 * because the flag is a negative value */
-		while(lock_time[i] == BUS_CHANNEL_FREE_FLAG && i < table_size)
-			i++;
-	
-		/* schedule before first event in table */
-		if(lock_time[i] > start_time && lock_time[i] - start_time >= duration)
-			sched_time = start_time;
-	
-		/* schedule in between other events in table */
-		if(sched_time == BUS_CHANNEL_FREE_FLAG)
+		finish_time = next -> second;
+		busy.erase(next++);
+	}
+	std::map<double, double>::iterator it = busy.insert(next, std::make_pair(sched_time, finish_time));
+	if(it != busy.begin())
+	{
+		std::map<double, double>::iterator prev = it;
+		prev--;
+		if(prev -> second == sched_time)
 		{
-			for(; i < table_size - 2; i++)
-			{
-				/* enough time to schedule in between next two events */
-				if(unlock_time[i] >= start_time  && lock_time[i + 1] - unlock_time[i] >= duration)
-				{
-					sched_time = unlock_time[i];
-					break;
-				}
-			}
+			prev -> second = finish_time;
+			busy.erase(it);
 		}
-	
-		/* schedule after all events in table */
-		if(sched_time == BUS_CHANNEL_FREE_FLAG)
-			sched_time = unlock_time[table_size - 1];
 	}
 
-	/* write scheduling info in free table slot */
-	lock_time[0] = sched_time;
-	unlock_time[0] = sched_time + duration;
-	table_entries++;
-
 	/* update event times for bus wait and time taken */
 	event.incr_bus_wait_time(sched_time - start_time);
 	event.incr_time_taken(sched_time - start_time + duration);
@@ -220,28 +163,15 @@ enum status Channel::lock(double start_time, double duration, Event &event)
 	return SUCCESS;
 }
 
-/* remove all expired entries (finish time is less than provided time)
- * update current number of table entries used
- * sort table by finish times (2nd row) */
+/* remove all expired intervals (finish time is not after provided time)
+ * they are the first ones in the map
+ * the events of a request lock the channel at different times, e.g. a read
+ * sends its data only after the die has read the page, so a lock cannot
+ * expire intervals itself: the caller unlocks up to a time no later lock
+ * can start before, such as the arrival of the request being serviced */
 void Channel::unlock(double start_time)
 {
-	unsigned int i;
-
-	/* remove expired channel lock entries */
-	for(i = 0; i < table_size; i++)
-	{
-		if(unlock_time[i] != BUS_CHANNEL_FREE_FLAG)
-		{
-			if(unlock_time[i] <= start_time)
-			{
-				lock_time[i] = unlock_time[i] = BUS_CHANNEL_FREE_FLAG;
-				table_entries--;
-			}
-		}
-	}
-
-	/* sort both arrays together - e.g. sort by first array but perform same
-	 * move operation on both arrays */
-	quicksort(lock_time, unlock_time, 0, table_size - 1);
+	while(!busy.empty() && busy.begin() -> second <= start_time)
+		busy.erase(busy.begin());
 	return;
 }
@@ -45,6 +45,10 @@ namespace ssd{
 #define MEM_ERR -1
 #define FILE_ERR -2
 
+/* set up the global geometry from the loaded configuration
+ * see ssd_geometry.cpp */
+void init_geometry(void);
+
 
 /* Simulator configuration
  * All configuration variables are set by reading ssd.conf and referenced with
@@ -63,15 +67,10 @@ double RAM_WRITE_DELAY = 0.00000001;
 /* Bus class:
  * 	delay to communicate over bus
  * 	max number of connected devices allowed
- * 	number of time entries bus has to keep track of future schedule usage
- * 	value used as a flag to indicate channel is free
- * 		(use a value not used as a delay value - e.g. -1.0)
  * 	number of simultaneous communication channels - defined by SSD_SIZE */
 double BUS_CTRL_DELAY = 0.000000005;
 double BUS_DATA_DELAY = 0.00000001;
 unsigned int BUS_MAX_CONNECT = 8;
-unsigned int BUS_TABLE_SIZE = 64;
-double BUS_CHANNEL_FREE_FLAG = -1.0;
 /* unsigned int BUS_CHANNELS = 4; same as # of Packages, defined by SSD_SIZE */
 
 /* Ssd class:
@@ -113,9 +112,80 @@ double PAGE_WRITE_DELAY = 0.00001;
 /* Overprovisioning allowed */
 float OVERPROVISIONING = 5;
 
-/* Selected garbage collection policy; default = RANDOM */
+/* Selected garbage collection policy; default = FIFO
+ * 	0: FIFO
+ * 	1: LRU
+ * 	2: GREEDY
+ * 	3: COST_BENEFIT */
 int SELECTED_GC_POLICY = 0;
 
+/* FTL implementation; default = hybrid log-block FTL
+ * 	0: hybrid log-block FTL (ssd_user.cpp)
+ * 	1: page-mapped FTL (ssd_page_ftl.cpp)
+ * 	2: DFTL, page-mapped FTL with a cached mapping table (ssd_page_ftl.cpp)
+ * 	3: FAST, hybrid FTL with shared random log blocks (ssd_user.cpp) */
+unsigned int FTL_IMPLEMENTATION = 0;
+
+/* DFTL mapping table:
+ * 	number of mapping entries cached in controller RAM */
+unsigned int MAP_CACHE_SIZE = 4096;
+
+/* Background garbage collection:
+ * 	time the drive has to be idle between requests before it cleans in the
+ * 		background, 0 disables background cleaning
+ * 	percentage of the overprovisioned blocks background cleaning keeps
+ * 		free */
+double GC_IDLE_THRESHOLD = 0.0;
+float GC_IDLE_WATERMARK = 25;
+
+/* Incremental garbage collection:
+ * 	pages a request copies for cleaning that was started earlier, 0 cleans
+ * 		blocks completely as they are needed
+ * 	percentage of the overprovisioned blocks below which requests clean
+ * 		incrementally */
+unsigned int GC_STEP_PAGES = 0;
+float GC_STEP_WATERMARK = 10;
+
+/* Hybrid FTL cleaning blocks:
+ * 	number of overprovisioned blocks full merges gather pages in, spread
+ * 		over the dies */
+unsigned int CLEANING_BLOCKS = 1;
+
+/* Static wear leveling:
+ * 	difference in erases between the most and least worn blocks above which
+ * 		the data of the least worn block is moved while the drive is idle,
+ * 		0 disables static wear leveling
+ * 	percentage of the elapsed time the moves can take */
+unsigned int WL_THRESHOLD = 0;
+float WL_RATE = 5;
+
+/* Page-mapped FTL write streams:
+ * 	0: every write takes the write frontier of the plane
+ * 	1: host writes are split into hot, warm and cold streams by how often
+ * 		their logical page is updated, and cleaning writes to a stream of
+ * 		its own, each stream filling its own blocks */
+unsigned int STREAM_SEPARATION = 0;
+
+/* Write throttling:
+ * 	longest time a host write is held for while the drive cleans, 0
+ * 		disables throttling
+ * 	percentages of the overprovisioned blocks free at and below which
+ * 		writes are held the longest, and from which they are not held */
+double THROTTLE_DELAY = 0.0;
+float THROTTLE_LOW_WATERMARK = 5;
+float THROTTLE_HIGH_WATERMARK = 25;
+
+/* Host interface:
+ * 	number of submission and completion queue pairs
+ * 	commands a queue pair can have outstanding, submitted and not completed
+ * 	arbitration between the submission queues
+ * 		0: round robin, one command from each queue in turn
+ * 		1: weighted round robin, as many commands from each queue in turn
+ * 			as its weight */
+unsigned int HOST_NUM_QUEUES = 1;
+unsigned int HOST_QUEUE_DEPTH = 32;
+unsigned int HOST_ARBITRATION = 0;
+
 /* Log file path name */
 char LOG_FILE[255] = "/tmp/ftl.log";
 
@@ -133,7 +203,7 @@ void load_entry(char *name, double value, unsigned int line_number)
 	else if(!strcmp(name, "BUS_MAX_CONNECT"))
 		BUS_MAX_CONNECT = (unsigned int) value;
 	else if(!strcmp(name, "BUS_TABLE_SIZE"))
-		BUS_TABLE_SIZE = (unsigned int) value;
+		fprintf(stderr, "Config file line %u: BUS_TABLE_SIZE is obsolete and ignored, bus channels no longer have a size limit\n", line_number);
 	else if(!strcmp(name, "SSD_SIZE"))
 		SSD_SIZE = (unsigned int) value;
 	else if(!strcmp(name, "PACKAGE_SIZE"))
@@ -160,6 +230,38 @@ void load_entry(char *name, double value, unsigned int line_number)
     OVERPROVISIONING = value;
   else if(!strcmp(name, "SELECTED_GC_POLICY"))
     SELECTED_GC_POLICY = value;
+	else if(!strcmp(name, "FTL_IMPLEMENTATION"))
+		FTL_IMPLEMENTATION = value;
+	else if(!strcmp(name, "MAP_CACHE_SIZE"))
+		MAP_CACHE_SIZE = value;
+	else if(!strcmp(name, "GC_IDLE_THRESHOLD"))
+		GC_IDLE_THRESHOLD = value;
+	else if(!strcmp(name, "GC_IDLE_WATERMARK"))
+		GC_IDLE_WATERMARK = value;
+	else if(!strcmp(name, "GC_STEP_PAGES"))
+		GC_STEP_PAGES = (unsigned int) value;
+	else if(!strcmp(name, "GC_STEP_WATERMARK"))
+		GC_STEP_WATERMARK = value;
+	else if(!strcmp(name, "CLEANING_BLOCKS"))
+		CLEANING_BLOCKS = (unsigned int) value;
+	else if(!strcmp(name, "WL_THRESHOLD"))
+		WL_THRESHOLD = (unsigned int) value;
+	else if(!strcmp(name, "WL_RATE"))
+		WL_RATE = value;
+	else if(!strcmp(name, "STREAM_SEPARATION"))
+		STREAM_SEPARATION = (unsigned int) value;
+	else if(!strcmp(name, "THROTTLE_DELAY"))
+		THROTTLE_DELAY = value;
+	else if(!strcmp(name, "THROTTLE_LOW_WATERMARK"))
+		THROTTLE_LOW_WATERMARK = value;
+	else if(!strcmp(name, "THROTTLE_HIGH_WATERMARK"))
+		THROTTLE_HIGH_WATERMARK = value;
+	else if(!strcmp(name, "HOST_NUM_QUEUES"))
+		HOST_NUM_QUEUES = (unsigned int) value;
+	else if(!strcmp(name, "HOST_QUEUE_DEPTH"))
+		HOST_QUEUE_DEPTH = (unsigned int) value;
+	else if(!strcmp(name, "HOST_ARBITRATION"))
+		HOST_ARBITRATION = (unsigned int) value;
   else
 		fprintf(stderr, "Config file parsing error on line %u\n", line_number);
 	return;
@@ -202,6 +304,9 @@ void load_config(const char *config_name)
 			fprintf(stderr, "Config file parsing error on line %u\n", line_number);
 	}
 	fclose(config_file);
+
+	/* precompute address translation for the loaded geometry */
+	init_geometry();
 	return;
 }
 
@@ -214,7 +319,6 @@ void print_config(FILE *stream)
 	fprintf(stream, "BUS_CTRL_DELAY: %.16lf\n", BUS_CTRL_DELAY);
 	fprintf(stream, "BUS_DATA_DELAY: %.16lf\n", BUS_DATA_DELAY);
 	fprintf(stream, "BUS_MAX_CONNECT: %u\n", BUS_MAX_CONNECT);
-	fprintf(stream, "BUS_TABLE_SIZE: %u\n", BUS_TABLE_SIZE);
 	fprintf(stream, "SSD_SIZE: %u\n", SSD_SIZE);
 	fprintf(stream, "PACKAGE_SIZE: %u\n", PACKAGE_SIZE);
 	fprintf(stream, "DIE_SIZE: %u\n", DIE_SIZE);
@@ -228,6 +332,22 @@ void print_config(FILE *stream)
 	fprintf(stream, "PAGE_WRITE_DELAY: %.16lf\n", PAGE_WRITE_DELAY);
   fprintf(stream, "OVERPROVISIONING: %f\n", OVERPROVISIONING);
   fprintf(stream, "SELECTED_GC_POLICY: %d\n", SELECTED_GC_POLICY);
+	fprintf(stream, "FTL_IMPLEMENTATION: %u\n", FTL_IMPLEMENTATION);
+	fprintf(stream, "MAP_CACHE_SIZE: %u\n", MAP_CACHE_SIZE);
+	fprintf(stream, "GC_IDLE_THRESHOLD: %.16lf\n", GC_IDLE_THRESHOLD);
+	fprintf(stream, "GC_IDLE_WATERMARK: %f\n", GC_IDLE_WATERMARK);
+	fprintf(stream, "GC_STEP_PAGES: %u\n", GC_STEP_PAGES);
+	fprintf(stream, "GC_STEP_WATERMARK: %f\n", GC_STEP_WATERMARK);
+	fprintf(stream, "CLEANING_BLOCKS: %u\n", CLEANING_BLOCKS);
+	fprintf(stream, "WL_THRESHOLD: %u\n", WL_THRESHOLD);
+	fprintf(stream, "WL_RATE: %f\n", WL_RATE);
+	fprintf(stream, "STREAM_SEPARATION: %u\n", STREAM_SEPARATION);
+	fprintf(stream, "THROTTLE_DELAY: %f\n", THROTTLE_DELAY);
+	fprintf(stream, "THROTTLE_LOW_WATERMARK: %f\n", THROTTLE_LOW_WATERMARK);
+	fprintf(stream, "THROTTLE_HIGH_WATERMARK: %f\n", THROTTLE_HIGH_WATERMARK);
+	fprintf(stream, "HOST_NUM_QUEUES: %u\n", HOST_NUM_QUEUES);
+	fprintf(stream, "HOST_QUEUE_DEPTH: %u\n", HOST_QUEUE_DEPTH);
+	fprintf(stream, "HOST_ARBITRATION: %u\n", HOST_ARBITRATION);
   fprintf(stream, "------------------------------------------------------------\n");
 	return;
 }
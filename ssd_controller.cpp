@@ -25,7 +25,9 @@
  * and consults the FTL regarding what to do by calling the FTL's read/write
  * methods.  The FTL returns an event list for the controller through its issue
  * method that the controller buffers in RAM and sends across the bus.  The
- * controller's issue method passes the events from the FTL to the SSD.
+ * controller's issue method passes the events from the FTL to the SSD after
+ * locking the channel of the event's package for the time the event uses it,
+ * so events to packages on the same channel wait for each other.
  *
  * The controller also provides an interface for the FTL to collect wear
  * information to perform wear-leveling.
@@ -66,10 +68,16 @@ enum status Controller::issue(Event &event_list)
 {
 	Event *cur;
 
+	/* the events of a list run one after the other, so an event waits for
+	 * the previous one to finish and the wait is part of its time */
+	double ready = 0.0;
+
 	/* go through event list and issue each to the hardware
 	 * stop processing events and return failure status if any event in the 
 	 *    list fails */
-	for(cur = &event_list; cur != NULL; cur = cur -> get_next()){
+	for(cur = &event_list; cur != NULL; ready = cur -> get_start_time() + cur -> get_time_taken(), cur = cur -> get_next()){
+		if(ready > cur -> get_start_time() + cur -> get_time_taken())
+			(void) cur -> incr_time_taken(ready - cur -> get_start_time() - cur -> get_time_taken());
 		if(cur -> get_size() != 1){
 			fprintf(stderr, "Controller: %s: Received non-single-page-sized event from FTL.\n", __func__);
 			return FAILURE;
@@ -77,7 +85,9 @@ enum status Controller::issue(Event &event_list)
 		else if(cur -> get_event_type() == READ)
 		{
 			assert(cur -> get_address().valid > NONE);
-			if(ssd.read(*cur) == FAILURE
+			if(lock_bus(*cur, BUS_CTRL_DELAY) == FAILURE
+				|| ssd.read(*cur) == FAILURE
+				|| lock_bus(*cur, BUS_DATA_DELAY) == FAILURE
 				|| ssd.ram.write(*cur) == FAILURE
 				|| ssd.ram.read(*cur) == FAILURE)
 				return FAILURE;
@@ -88,20 +98,28 @@ enum status Controller::issue(Event &event_list)
       ssd.write_ref_map(cur->get_logical_address(), cur->get_address());
 			if(ssd.ram.write(*cur) == FAILURE
 				|| ssd.ram.read(*cur) == FAILURE
+				|| lock_bus(*cur, BUS_CTRL_DELAY + BUS_DATA_DELAY) == FAILURE
 				|| ssd.write(*cur) == FAILURE)
 				return FAILURE;
 		}
 		else if(cur -> get_event_type() == ERASE)
 		{
 			assert(cur -> get_address().valid > NONE);
-				if(ssd.erase(*cur) == FAILURE)
+			if(lock_bus(*cur, BUS_CTRL_DELAY) == FAILURE
+				|| ssd.erase(*cur) == FAILURE)
 				return FAILURE;
 		}
 		else if(cur -> get_event_type() == MERGE)
 		{
 			assert(cur -> get_address().valid > NONE);
 			assert(cur -> get_merge_address().valid > NONE);
-			if(ssd.merge(*cur) == FAILURE)
+
+			/* a page merge is a copyback of the event's logical page, which
+			 * stays inside the die and does not go through RAM */
+			if(cur -> get_address().valid == PAGE)
+				ssd.write_ref_map(cur -> get_logical_address(), cur -> get_merge_address());
+			if(lock_bus(*cur, BUS_CTRL_DELAY) == FAILURE
+				|| ssd.merge(*cur) == FAILURE)
 				return FAILURE;
 		}
 		else
@@ -113,6 +131,41 @@ enum status Controller::issue(Event &event_list)
 	return SUCCESS;
 }
 
+/* lock the channel of the event's package for a transfer of duration
+ * a read sends its command before the page is read from the die and its data
+ * after, so the channel is free while the read waits for the die; writes send
+ * command and data before the program; erases and merges only send a command
+ * the transfer starts after the event's time so far and waits for the
+ * channel if another transfer holds it then
+ * the wait and the transfer are added to the event's time */
+enum status Controller::lock_bus(Event &event, double duration)
+{
+	if(duration <= 0.0)
+		return SUCCESS;
+
+	double start_time = event.get_start_time() + event.get_time_taken();
+	if(ssd.bus.lock(event.get_address().package, start_time, duration, event) == FAILURE)
+	{
+		fprintf(log_file, "Controller: %s: could not lock channel %u\n", __func__, event.get_address().package);
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+
+/* clean in the background while the drive is idle
+ * returns the number of blocks cleaned */
+unsigned int Controller::collect_idle(Event &event, double idle_time)
+{
+	return ftl.collect_idle(event, idle_time);
+}
+
+/* take one step of background cleaning, see Ftl::collect_idle_step()
+ * returns the number of blocks cleaned or moved */
+unsigned int Controller::collect_idle_step(Event &event)
+{
+	return ftl.collect_idle_step(event);
+}
+
 unsigned long Controller::get_erases_remaining(const Address &address) const
 {
 	assert(address.valid > NONE);
@@ -125,6 +178,12 @@ void Controller::get_least_worn(Address &address) const
 	return ssd.get_least_worn(address);
 }
 
+void Controller::get_most_worn(Address &address) const
+{
+	assert(address.valid > NONE);
+	return ssd.get_most_worn(address);
+}
+
 double Controller::get_last_erase_time(const Address &address) const
 {
 	assert(address.valid > NONE);
@@ -143,6 +202,13 @@ void Controller::get_free_page(Address &address) const
 	return;
 }
 
+void Controller::get_free_block(Address &address) const
+{
+	assert(address.valid > NONE);
+	ssd.get_free_block(address);
+	return;
+}
+
 unsigned int Controller::get_num_free(const Address &address) const
 {
 	assert(address.valid > NONE);
@@ -154,3 +220,15 @@ unsigned int Controller::get_num_valid(const Address &address) const
 	assert(address.valid > NONE);
 	return ssd.get_num_valid(address);
 }
+
+unsigned int Controller::get_victim(Address &address) const
+{
+	return ssd.get_victim(address);
+}
+
+void Controller::invalidate_page(const Address &address)
+{
+	assert(address.valid == PAGE);
+	ssd.invalidate_page(address);
+	return;
+}
@@ -40,7 +40,7 @@ Die::Die(const Package &parent, Channel &channel, unsigned int die_size):
 	channel(channel),
 
 	/* assume all Planes are same so first one can start as least worn */
-	least_worn(0),
+	wear(size, BLOCK_ERASES),
 
 	/* set erases remaining to BLOCK_ERASES to match Block constructor args 
 	 * in Plane class
@@ -48,7 +48,10 @@ Die::Die(const Package &parent, Channel &channel, unsigned int die_size):
 	erases_remaining(BLOCK_ERASES),
 
 	/* assume hardware created at time 0 and had an implied free erasure */
-	last_erase_time(0.0)
+	last_erase_time(0.0),
+
+	/* nothing has run on the die yet */
+	busy_until(0.0)
 {
 	unsigned int i;
 
@@ -89,14 +92,20 @@ enum status Die::read(Event &event)
 {
 	assert(data != NULL);
 	assert(event.get_address().plane < size && event.get_address().valid > DIE);
-	return data[event.get_address().plane].read(event);
+	wait(event);
+	enum status status = data[event.get_address().plane].read(event);
+	hold(event);
+	return status;
 }
 
 enum status Die::write(Event &event)
 {
 	assert(data != NULL);
 	assert(event.get_address().plane < size && event.get_address().valid > DIE);
-	return data[event.get_address().plane].write(event);
+	wait(event);
+	enum status status = data[event.get_address().plane].write(event);
+	hold(event);
+	return status;
 }
 
 /* if no errors
@@ -107,7 +116,9 @@ enum status Die::erase(Event &event)
 {
 	assert(data != NULL);
 	assert(event.get_address().plane < size && event.get_address().valid > DIE);
+	wait(event);
 	enum status status = data[event.get_address().plane].erase(event);
+	hold(event);
 
 	/* update values if no errors */
 	if(status == SUCCESS)
@@ -115,25 +126,120 @@ enum status Die::erase(Event &event)
 	return status;
 }
 
-/* TODO: move Plane::_merge() to Die and make generic to handle merge across
- * 	both cases: 2 separate planes or within 1 plane */
+/* merges within 1 plane are done by the plane through its register
+ * merges across 2 planes are done by the die, see Die::_merge() */
 enum status Die::merge(Event &event)
 {
 	assert(data != NULL);
 	assert(event.get_address().plane < size && event.get_address().valid > DIE && event.get_merge_address().plane < size && event.get_merge_address().valid > DIE);
+	enum status status;
+	wait(event);
 	if(event.get_address().plane != event.get_merge_address().plane)
-		return _merge(event);
-	else return data[event.get_address().plane]._merge(event);
+		status = _merge(event);
+	else
+		status = data[event.get_address().plane]._merge(event);
+	hold(event);
+	return status;
+}
+
+/* delay the event until the die is free
+ * the event arrives at the die after the time it has taken so far */
+void Die::wait(Event &event) const
+{
+	double arrive_time = event.get_start_time() + event.get_time_taken();
+	if(busy_until > arrive_time)
+		(void) event.incr_time_taken(busy_until - arrive_time);
+	return;
+}
+
+/* keep the die busy until the event finishes */
+void Die::hold(const Event &event)
+{
+	busy_until = event.get_start_time() + event.get_time_taken();
+	return;
 }
 
-/* TODO: update stub as per Die::merge() comment above
- * to support Die-level merge operations */
+/* merge across 2 planes of the die
+ * 	address.block and address_merge.block must be valid
+ * 	move event::address valid pages to event::address_merge empty pages
+ * 	a page address limits the merge to that page
+ * each page is read into the register of its plane, moved to the register of
+ * the other plane and written from there, so the data does not cross the
+ * channel */
 enum status Die::_merge(Event &event)
 {
 	assert(data != NULL);
 	assert(event.get_address().plane < size && event.get_address().valid > DIE && event.get_merge_address().plane < size && event.get_merge_address().valid > DIE);
 	assert(event.get_address().plane != event.get_merge_address().plane);
-	return SUCCESS;
+	unsigned int merge_count = 0;
+	unsigned int merge_avail = 0;
+	unsigned int failures = 0;
+	double total_delay = 0;
+
+	/* pages to move and pages to move them to */
+	const Address &address = event.get_address();
+	const Address &merge_address = event.get_merge_address();
+	Plane &source = data[address.plane];
+	Plane &target = data[merge_address.plane];
+	Address read(address);
+	Address write(merge_address);
+	unsigned int last_page = BLOCK_SIZE;
+	unsigned int last_merge_page = BLOCK_SIZE;
+	if(address.valid == PAGE)
+		last_page = address.page + 1;
+	else
+		read.page = 0;
+	if(merge_address.valid == PAGE)
+		last_merge_page = merge_address.page + 1;
+	else
+		write.page = 0;
+	read.valid = PAGE;
+	write.valid = PAGE;
+
+	/* fail if not enough space to do the merge */
+	for(; read.page < last_page; read.page++)
+		if(source.get_state(read) == VALID)
+			merge_count++;
+	for(; write.page < last_merge_page; write.page++)
+		if(target.get_state(write) == EMPTY)
+			merge_avail++;
+	if(merge_count > merge_avail)
+	{
+		fprintf(stderr, "Die error: %s: Not enough space to merge block %d into block %d\n", __func__, address.block, merge_address.block);
+		return FAILURE;
+	}
+
+	Event read_event(READ, 0, 1, event.get_start_time());
+	Event write_event(WRITE, 0, 1, event.get_start_time());
+	read.page = address.valid == PAGE ? address.page : 0;
+	write.page = merge_address.valid == PAGE ? merge_address.page : 0;
+	for(; merge_count > 0 && read.page < last_page; read.page++)
+	{
+		if(source.get_state(read) != VALID)
+			continue;
+
+		/* read from page and set status to invalid */
+		read_event.set_address(read);
+		if(source.read(read_event) == FAILURE)
+			failures++;
+		source.invalidate_page(read);
+
+		/* write to the next empty page of the other plane */
+		while(target.get_state(write) != EMPTY)
+			write.page++;
+		write_event.set_address(write);
+		if(target.write(write_event) == FAILURE)
+			failures++;
+		total_delay += PLANE_REG_WRITE_DELAY + PLANE_REG_READ_DELAY;
+		merge_count--;
+	}
+	total_delay += read_event.get_time_taken() + write_event.get_time_taken();
+	event.incr_time_taken(total_delay);
+
+	if(failures == 0)
+		return SUCCESS;
+	fprintf(stderr, "Die error: %s: %u failures during merge operation\n", __func__, failures);
+	return FAILURE;
 }
 
 const Package &Die::get_parent(void) const
@@ -163,32 +269,44 @@ unsigned long Die::get_erases_remaining(const Address &address) const
 		return erases_remaining;
 }
 
-/* Plane with the most erases remaining is the least worn */
+/* Plane with the most erases remaining is the least worn
+ * only the plane holding the erased block changed, so only its path in the
+ * wear index is replayed */
 void Die::update_wear_stats(const Address &address)
 {
-	assert(data != NULL);
-	unsigned int i;
-	unsigned int max_index = 0;
-	unsigned long max = data[0].get_erases_remaining(address);
-	for(i = 1; i < size; i++)
-		if(data[i].get_erases_remaining(address) > max)
-			max_index = i;
-	least_worn = max_index;
-	erases_remaining = max;
-	last_erase_time = data[max_index].get_last_erase_time(address);
+	assert(data != NULL && address.plane < size);
+	wear.update(address.plane, data[address.plane].get_wear_index());
+	erases_remaining = wear.get_max_erases_remaining();
+	if(data[address.plane].get_last_erase_time(address) > last_erase_time)
+		last_erase_time = data[address.plane].get_last_erase_time(address);
 	return;
 }
 
-/* update given address -> die to least worn die */
+/* update given address -> plane to least worn plane */
 void Die::get_least_worn(Address &address) const
 {
-	assert(data != NULL && least_worn < size);
-	address.plane = least_worn;
+	assert(data != NULL);
+	address.plane = wear.get_least_worn();
 	address.valid = PLANE;
-	data[least_worn].get_least_worn(address);
+	data[address.plane].get_least_worn(address);
 	return;
 }
 
+/* update given address -> plane to most worn plane */
+void Die::get_most_worn(Address &address) const
+{
+	assert(data != NULL);
+	address.plane = wear.get_most_worn();
+	address.valid = PLANE;
+	data[address.plane].get_most_worn(address);
+	return;
+}
+
+const Wear_index &Die::get_wear_index(void) const
+{
+	return wear;
+}
+
 enum page_state Die::get_state(const Address &address) const
 {  
 	assert(data != NULL && address.plane < size && address.valid >= DIE);
@@ -202,6 +320,13 @@ void Die::get_free_page(Address &address) const
 	return;
 }
 
+void Die::get_free_block(Address &address) const
+{
+	assert(address.plane < size && address.valid >= PLANE);
+	data[address.plane].get_free_block(address);
+	return;
+}
+
 unsigned int Die::get_num_free(const Address &address) const
 {
 	assert(address.valid >= PLANE);
@@ -213,3 +338,32 @@ unsigned int Die::get_num_valid(const Address &address) const
 	assert(address.valid >= PLANE);
 	return data[address.plane].get_num_valid(address);
 }   
+
+/* the fully written block with the fewest valid pages of any plane
+ * returns its number of valid pages or BLOCK_SIZE + 1 if there is none */
+unsigned int Die::get_victim(Address &address) const
+{
+	unsigned int i;
+	unsigned int min_valid = BLOCK_SIZE + 1;
+	Address victim(address);
+	for(i = 0; i < size; i++)
+	{
+		address.plane = i;
+		address.valid = PLANE;
+		unsigned int valid = data[i].get_victim(address);
+		if(valid < min_valid)
+		{
+			min_valid = valid;
+			victim = address;
+		}
+	}
+	address = victim;
+	return min_valid;
+}
+
+void Die::invalidate_page(const Address &address)
+{
+	assert(address.plane < size && address.valid >= PLANE);
+	data[address.plane].invalidate_page(address);
+	return;
+}
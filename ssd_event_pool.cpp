@@ -0,0 +1,103 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_event_pool.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Event_pool class
+ *
+ * Fixed array of events the FTL builds its internal requests in, so that
+ * cleaning does not allocate.  Events are handed out in order and each one
+ * is linked to the one before it in the same list, so the events in use form
+ * up to num_lists lists, such as one per die, that can each be issued to the
+ * controller in one call.  clear ends the lists and makes every slot
+ * available again. */
+
+#include <algorithm>
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+Event_pool::Event_pool(unsigned int size, unsigned int num_lists):
+	size(size),
+	used(0),
+
+	/* use a const pointer to use as an array
+	 * but like a reference, we cannot reseat the pointer */
+	events((Event *) malloc(size * sizeof(Event))),
+	heads(num_lists, (Event *) NULL),
+	tails(num_lists, (Event *) NULL)
+{
+	assert(size > 0 && num_lists > 0);
+	if(events == NULL)
+	{
+		fprintf(stderr, "Event_pool error: %s: constructor unable to allocate events\n", __func__);
+		exit(MEM_ERR);
+	}
+	return;
+}
+
+Event_pool::~Event_pool(void)
+{
+	clear();
+	free(events);
+	return;
+}
+
+/* take the next event and append it to the list
+ * the pool must not be full */
+Event &Event_pool::get(enum event_type type, unsigned long logical_address, double start_time, unsigned int list)
+{
+	assert(used < size && list < heads.size());
+	Event *event = new (&events[used++]) Event(type, logical_address, 1, start_time);
+	if(tails[list] != NULL)
+		tails[list] -> set_next(*event);
+	else
+		heads[list] = event;
+	tails[list] = event;
+	return *event;
+}
+
+/* first event of the list, NULL if the list is empty */
+Event *Event_pool::get_list(unsigned int list) const
+{
+	assert(list < heads.size());
+	return heads[list];
+}
+
+unsigned int Event_pool::get_num_lists(void) const
+{
+	return heads.size();
+}
+
+bool Event_pool::is_full(void) const
+{
+	return used == size;
+}
+
+void Event_pool::clear(void)
+{
+	for(unsigned int i = 0; i < used; i++)
+		events[i].~Event();
+	used = 0;
+	std::fill(heads.begin(), heads.end(), (Event *) NULL);
+	std::fill(tails.begin(), tails.end(), (Event *) NULL);
+	return;
+}
@@ -29,6 +29,7 @@
 #include <new>
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "ssd.h"
 
 
@@ -38,14 +39,37 @@ Ftl::Ftl(Controller &controller, FILE *log_file):
 	log_file(log_file),
   controller(controller),
 	garbage(*this, log_file),
-	wear(*this, log_file)
+	wear(*this, log_file),
+	event_pool(2 * BLOCK_SIZE * SSD_SIZE * PACKAGE_SIZE, SSD_SIZE * PACKAGE_SIZE),
+	page_ftl(NULL),
+	log_block_map(NULL),
+	sequential_log_block(NULL),
+	log_page_map(NULL),
+	data_block_map(NULL),
+	block_owner(NULL)
 {
+	if(FTL_IMPLEMENTATION == PAGE_MAPPED || FTL_IMPLEMENTATION == DFTL)
+	{
+		page_ftl = (Page_ftl *) malloc(sizeof(Page_ftl));
+		if(page_ftl == NULL)
+		{
+			fprintf(stderr, "Ftl error: %s: constructor unable to allocate page-mapped FTL\n", __func__);
+			exit(MEM_ERR);
+		}
+		(void) new (page_ftl) Page_ftl(*this, log_file);
+		return;
+	}
   init_ftl_user();
 	return;
 }
 
 Ftl::~Ftl(void)
 {
+	if(page_ftl != NULL)
+	{
+		page_ftl -> ~Page_ftl();
+		free(page_ftl);
+	}
 	return;
 }
 
@@ -80,6 +104,7 @@ enum status Ftl::write(Event &event)
   Address pba;
   enum status retVal;
 
+  throttle(event);
   retVal = translate( event );
   if(retVal != SUCCESS) {
     fprintf(log_file, "%s: Invalid mapping of LBA %lu\n", __func__,
@@ -141,7 +166,135 @@ enum status Ftl::merge(Event &event)
 	return controller.issue(event);
 }
 
+/* write frontier of the plane given by the address */
+void Ftl::get_free_page(Address &address) const
+{
+	controller.get_free_page(address);
+	return;
+}
+
+/* least worn free block of the plane given by the address other than the
+ * block holding its write frontier */
+void Ftl::get_free_block(Address &address) const
+{
+	controller.get_free_block(address);
+	return;
+}
+
+/* number of free blocks in the plane given by the address */
+unsigned int Ftl::get_num_free(const Address &address) const
+{
+	return controller.get_num_free(address);
+}
+
+/* fully written block with the fewest valid pages in the drive
+ * returns its number of valid pages or BLOCK_SIZE + 1 if there is none */
+unsigned int Ftl::get_victim(Address &address) const
+{
+	return controller.get_victim(address);
+}
+
+/* mark the old copy of a page stale after it is written elsewhere */
+void Ftl::invalidate_page(const Address &address)
+{
+	controller.invalidate_page(address);
+	return;
+}
+
+unsigned long Ftl::get_erases_remaining(const Address &address) const
+{
+	return controller.get_erases_remaining(address);
+}
+
+/* block with the most erases remaining in the drive */
+void Ftl::get_least_worn(Address &address) const
+{
+	address.valid = PACKAGE;
+	controller.get_least_worn(address);
+	return;
+}
+
+/* block with the fewest erases remaining in the drive */
+void Ftl::get_most_worn(Address &address) const
+{
+	address.valid = PACKAGE;
+	controller.get_most_worn(address);
+	return;
+}
+
+double Ftl::get_last_erase_time(const Address &address) const
+{
+	return controller.get_last_erase_time(address);
+}
+
 enum status Ftl::garbage_collect(Event &event)
 {
 	return garbage.collect(event, SELECTED_GC_POLICY);
 }
+
+/* clean in the background for up to idle_time after the start of the event
+ * until GC_IDLE_WATERMARK percent of the overprovisioned blocks are free,
+ * then level the wear with the rest of the idle time
+ * returns the number of blocks cleaned or moved */
+unsigned int Ftl::collect_idle(Event &event, double idle_time)
+{
+	unsigned int cleaned;
+	if(page_ftl != NULL)
+		cleaned = page_ftl -> collect_idle(event, idle_time, GC_IDLE_WATERMARK);
+	else
+		cleaned = garbage.collect_idle(event, idle_time, GC_IDLE_WATERMARK);
+	return cleaned + wear.level(event, idle_time);
+}
+
+/* clean one block in the background if fewer than GC_IDLE_WATERMARK percent
+ * of the overprovisioned blocks are free, and otherwise move the data of one
+ * block to level the wear
+ * returns the number of blocks cleaned or moved, 0 once there is nothing
+ * left to do */
+unsigned int Ftl::collect_idle_step(Event &event)
+{
+	unsigned int cleaned;
+	if(page_ftl != NULL)
+		cleaned = page_ftl -> collect_idle_step(event, GC_IDLE_WATERMARK);
+	else
+		cleaned = garbage.collect_idle_step(event, GC_IDLE_WATERMARK);
+	if(cleaned > 0)
+		return cleaned;
+	return wear.level_step(event) == SUCCESS ? 1 : 0;
+}
+
+/* percentage of the overprovisioned blocks that are free: the free blocks of
+ * the page-mapped FTL or the free log blocks of the hybrid FTL */
+double Ftl::get_free_reserve(void) const
+{
+	if(page_ftl != NULL)
+		return page_ftl -> get_free_reserve();
+	return 100.0 * free_log_blocks.size() / log_blocks.size();
+}
+
+/* hold a host write while the drive pays off its cleaning debt
+ * below THROTTLE_HIGH_WATERMARK percent of the overprovisioned blocks free,
+ * the write is held for a share of THROTTLE_DELAY that grows with the debt,
+ * all of it at THROTTLE_LOW_WATERMARK, and the drive cleans up to the high
+ * watermark meanwhile
+ * spreading cleaning over the writes this way slows writes down gradually as
+ * free blocks run low rather than making a few writes wait for whole
+ * cleanings */
+void Ftl::throttle(Event &event)
+{
+	double free = get_free_reserve();
+	if(THROTTLE_DELAY <= 0.0 || free >= THROTTLE_HIGH_WATERMARK)
+		return;
+
+	double debt = 1.0;
+	if(free > THROTTLE_LOW_WATERMARK)
+		debt = (THROTTLE_HIGH_WATERMARK - free) / (THROTTLE_HIGH_WATERMARK - THROTTLE_LOW_WATERMARK);
+	double hold = event.get_time_taken() + debt * THROTTLE_DELAY;
+	if(page_ftl != NULL)
+		page_ftl -> collect_throttled(event, hold, THROTTLE_HIGH_WATERMARK);
+	else
+		garbage.collect_throttled(event, hold, THROTTLE_HIGH_WATERMARK);
+	if(event.get_time_taken() < hold)
+		(void) event.incr_time_taken(hold - event.get_time_taken());
+	return;
+}
@@ -33,9 +33,18 @@
 using namespace ssd;
 
 Garbage_collector::Garbage_collector(Ftl &ftl, FILE *log_file):
+  request(NULL),
+  merges(),
+  passed_victims(),
+  victims(BLOCK_SIZE),
   log_file(log_file),
-  ftl(ftl)
+  ftl(ftl),
+  num_switch_merges(0),
+  num_partial_merges(0),
+  num_full_merges(0)
 {
+	merges.reserve(SSD_SIZE * PACKAGE_SIZE);
+	passed_victims.reserve(SSD_SIZE * PACKAGE_SIZE);
 	return;
 }
 
@@ -0,0 +1,208 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_geometry.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Geometry class
+ *
+ * Translates between logical page addresses and physical addresses.  The
+ * divisors are fixed once the configuration is loaded, so all of the work of
+ * dividing is done up front in init_geometry(): power of two geometries
+ * translate with shifts and masks and other geometries with multiplies by
+ * precomputed magic numbers. */
+
+#include <assert.h>
+#include <stdio.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+/* bit position of the address_valid status in a packed address
+ * 3 bits hold every enum address_valid value */
+#define VALID_SHIFT 61
+
+/* global geometry set up from the configuration by load_config() */
+Geometry ssd::GEOMETRY;
+
+void ssd::init_geometry(void)
+{
+	GEOMETRY.init(SSD_SIZE, PACKAGE_SIZE, DIE_SIZE, PLANE_SIZE, BLOCK_SIZE);
+	return;
+}
+
+void Divider::init(unsigned long divisor)
+{
+	assert(divisor > 0);
+	this -> divisor = divisor;
+	power_of_two = (divisor & (divisor - 1)) == 0;
+	mask = divisor - 1;
+	for(shift = 0; (1UL << shift) < divisor; shift++)
+		;
+
+	/* ceil(2^64 / divisor)
+	 * does not fit in 64 bits for a divisor of 1, which is handled with the
+	 * powers of two */
+	magic = divisor == 1 ? 0 : ~0UL / divisor + 1;
+	return;
+}
+
+/* quotient and remainder of a logical address by a configured size
+ * the magic number is exact for numerators and divisors below 2^32, which
+ * covers every simulated drive smaller than 2^32 pages */
+namespace {
+template <bool POWER_OF_TWO> struct Divide;
+
+template <> struct Divide<true>
+{
+	static unsigned long quotient(const Divider &d, unsigned long n) { return n >> d.shift; }
+	static unsigned long remainder(const Divider &d, unsigned long n) { return n & d.mask; }
+};
+
+template <> struct Divide<false>
+{
+	static unsigned long quotient(const Divider &d, unsigned long n)
+	{
+		if(d.divisor == 1)
+			return n;
+		if(n >> 32 != 0)
+			return n / d.divisor;
+		return (unsigned long) (((unsigned __int128) d.magic * n) >> 64);
+	}
+	static unsigned long remainder(const Divider &d, unsigned long n)
+	{
+		if(n >> 32 != 0)
+			return n % d.divisor;
+		return (unsigned long) (((unsigned __int128) (d.magic * n) * d.divisor) >> 64);
+	}
+};
+}
+
+void Geometry::init(unsigned int ssd_size, unsigned int package_size, unsigned int die_size, unsigned int plane_size, unsigned int block_size)
+{
+	this -> package_size.init(package_size);
+	this -> die_size.init(die_size);
+	this -> plane_size.init(plane_size);
+	this -> block_size.init(block_size);
+	num_blocks = (unsigned long) ssd_size * package_size * die_size * plane_size;
+	power_of_two = this -> package_size.power_of_two && this -> die_size.power_of_two
+		&& this -> plane_size.power_of_two && this -> block_size.power_of_two;
+
+	/* packed address fields from the page up, each just wide enough for its
+	 * size
+	 * the address_valid status goes in the top bits */
+	Divider ssd_divider;
+	ssd_divider.init(ssd_size);
+	const Divider *field_size[PAGE + 1] = {NULL, &ssd_divider, &this -> package_size, &this -> die_size, &this -> plane_size, &this -> block_size};
+	unsigned int level;
+	unsigned int shift = 0;
+	for(level = PAGE; level > NONE; level--)
+	{
+		field_shift[level] = shift;
+		field_mask[level] = (1UL << field_size[level] -> shift) - 1;
+		shift += field_size[level] -> shift;
+	}
+	field_shift[NONE] = VALID_SHIFT;
+	field_mask[NONE] = ~0UL >> VALID_SHIFT;
+	assert(shift <= VALID_SHIFT);
+	return;
+}
+
+template <bool POWER_OF_TWO> void Geometry::_decompose(unsigned long logical_address, Address &address) const
+{
+	address.page = Divide<POWER_OF_TWO>::remainder(block_size, logical_address);
+	logical_address = Divide<POWER_OF_TWO>::quotient(block_size, logical_address);
+	address.block = Divide<POWER_OF_TWO>::remainder(plane_size, logical_address);
+	logical_address = Divide<POWER_OF_TWO>::quotient(plane_size, logical_address);
+	address.plane = Divide<POWER_OF_TWO>::remainder(die_size, logical_address);
+	logical_address = Divide<POWER_OF_TWO>::quotient(die_size, logical_address);
+	address.die = Divide<POWER_OF_TWO>::remainder(package_size, logical_address);
+	address.package = Divide<POWER_OF_TWO>::quotient(package_size, logical_address);
+	address.valid = PAGE;
+	return;
+}
+
+/* split a logical page address into a page address */
+void Geometry::decompose(unsigned long logical_address, Address &address) const
+{
+	if(power_of_two)
+		_decompose<true>(logical_address, address);
+	else
+		_decompose<false>(logical_address, address);
+	return;
+}
+
+/* inverse of decompose
+ * address fields that are not valid are treated as 0, so a block address
+ * gives the logical address of the first page of the block */
+unsigned long Geometry::compose(const Address &address) const
+{
+	unsigned long logical_address = address.valid >= PACKAGE ? address.package : 0;
+	logical_address = logical_address * package_size.divisor + (address.valid >= DIE ? address.die : 0);
+	logical_address = logical_address * die_size.divisor + (address.valid >= PLANE ? address.plane : 0);
+	logical_address = logical_address * plane_size.divisor + (address.valid >= BLOCK ? address.block : 0);
+	return logical_address * block_size.divisor + (address.valid >= PAGE ? address.page : 0);
+}
+
+/* logical block number of a logical page address */
+unsigned long Geometry::get_block(unsigned long logical_address) const
+{
+	if(power_of_two)
+		return Divide<true>::quotient(block_size, logical_address);
+	return Divide<false>::quotient(block_size, logical_address);
+}
+
+/* page offset of a logical page address within its block */
+unsigned int Geometry::get_page(unsigned long logical_address) const
+{
+	if(power_of_two)
+		return Divide<true>::remainder(block_size, logical_address);
+	return Divide<false>::remainder(block_size, logical_address);
+}
+
+unsigned long Geometry::get_num_blocks(void) const
+{
+	return num_blocks;
+}
+
+unsigned long Geometry::get_num_pages(void) const
+{
+	return num_blocks * block_size.divisor;
+}
+
+/* pack an address into 64 bits for Ppa */
+unsigned long Geometry::pack(const Address &address) const
+{
+	assert(address.package <= field_mask[PACKAGE] && address.die <= field_mask[DIE] && address.plane <= field_mask[PLANE] && address.block <= field_mask[BLOCK] && address.page <= field_mask[PAGE]);
+	return ((unsigned long) address.valid << field_shift[NONE])
+		| ((unsigned long) address.package << field_shift[PACKAGE])
+		| ((unsigned long) address.die << field_shift[DIE])
+		| ((unsigned long) address.plane << field_shift[PLANE])
+		| ((unsigned long) address.block << field_shift[BLOCK])
+		| ((unsigned long) address.page << field_shift[PAGE]);
+}
+
+/* inverse of pack */
+void Geometry::unpack(unsigned long packed, Address &address) const
+{
+	address.valid = (enum address_valid) ((packed >> field_shift[NONE]) & field_mask[NONE]);
+	address.package = (packed >> field_shift[PACKAGE]) & field_mask[PACKAGE];
+	address.die = (packed >> field_shift[DIE]) & field_mask[DIE];
+	address.plane = (packed >> field_shift[PLANE]) & field_mask[PLANE];
+	address.block = (packed >> field_shift[BLOCK]) & field_mask[BLOCK];
+	address.page = (packed >> field_shift[PAGE]) & field_mask[PAGE];
+	return;
+}
@@ -0,0 +1,214 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_host.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Host_interface class
+ *
+ * Submission and completion queue pairs in front of the drive, in the manner
+ * of NVMe (or of NCQ with one pair).  Each pair allows queue_depth commands
+ * to be outstanding; a submission to a full pair fails, as a host cannot
+ * submit more commands than it has tags for.  Commands wait in their
+ * submission queue until the simulation reaches their time.  The commands
+ * then due are fetched in arbitration order: round robin takes one command
+ * from each queue in turn, weighted round robin as many as the weight of the
+ * queue.  The drive services commands in the order they are fetched, so
+ * arbitration decides which command of a burst gets a die or channel first.
+ * Arbitration resumes with the queue after the last one served.
+ *
+ * The drive gives each fetched command a request id of its own.  The
+ * interface maps it back to the queue and the id the host got at submission
+ * when the command completes. */
+
+#include <new>
+#include <assert.h>
+#include <float.h>
+#include <stdio.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+Host_interface::Host_interface(Ssd &ssd, unsigned int num_queues, unsigned int queue_depth):
+	ssd(ssd),
+	num_queues(num_queues),
+	queue_depth(queue_depth),
+	submission(num_queues),
+	completion(num_queues),
+	outstanding(num_queues, 0),
+	weight(num_queues, 1),
+	fetched(),
+	next_queue(0),
+	next_id(0)
+{
+	assert(num_queues > 0 && queue_depth > 0);
+	return;
+}
+
+Host_interface::~Host_interface(void)
+{
+	return;
+}
+
+/* add a command to the submission queue, to be fetched at time
+ * commands of a queue must be submitted in time order
+ * returns FAILURE if the queue has queue_depth commands outstanding */
+enum status Host_interface::submit(unsigned int queue, enum event_type type, unsigned long logical_address, unsigned int size, double time, unsigned long &id)
+{
+	assert(queue < num_queues && time >= ssd.get_time());
+	assert(submission[queue].empty() || time >= submission[queue].back().arrive_time);
+	if(outstanding[queue] == queue_depth)
+		return FAILURE;
+
+	Request command;
+	command.id = next_id++;
+	command.type = type;
+	command.logical_address = logical_address;
+	command.size = size;
+	command.arrive_time = time;
+	command.finish_time = time;
+	command.bus_wait_time = 0.0;
+	command.status = FAILURE;
+	submission[queue].push_back(command);
+	outstanding[queue]++;
+	id = command.id;
+	return SUCCESS;
+}
+
+/* commands fetched from the queue in each turn of weighted round robin */
+void Host_interface::set_weight(unsigned int queue, unsigned int weight)
+{
+	assert(queue < num_queues && weight > 0);
+	this -> weight[queue] = weight;
+	return;
+}
+
+/* fetch the commands due and run the drive up to and including time until */
+void Host_interface::run(double until)
+{
+	double time;
+	while(get_next_fetch(time) && time <= until)
+	{
+		ssd.run(time);
+		post();
+		fetch(time);
+	}
+	ssd.run(until);
+	post();
+	return;
+}
+
+/* run until nothing is left to do */
+void Host_interface::run(void)
+{
+	run(DBL_MAX);
+	return;
+}
+
+/* run to the next time a command is due or the drive has an event
+ * returns false if there is neither */
+bool Host_interface::step(void)
+{
+	double time = ssd.get_next_time();
+	double fetch_time;
+	if(get_next_fetch(fetch_time) && fetch_time < time)
+		time = fetch_time;
+	if(time == DBL_MAX)
+		return false;
+	run(time);
+	return true;
+}
+
+/* take the earliest completion of the queue not yet taken
+ * returns false if none of its commands has completed since the last call */
+bool Host_interface::get_completion(unsigned int queue, Request &request)
+{
+	assert(queue < num_queues);
+	if(completion[queue].empty())
+		return false;
+	request = completion[queue].front();
+	completion[queue].pop_front();
+	return true;
+}
+
+/* commands of the queue submitted and not completed */
+unsigned int Host_interface::get_outstanding(unsigned int queue) const
+{
+	assert(queue < num_queues);
+	return outstanding[queue];
+}
+
+/* the simulation clock */
+double Host_interface::get_time(void) const
+{
+	return ssd.get_time();
+}
+
+/* time the earliest command waiting in a submission queue is due
+ * returns false if no command is waiting */
+bool Host_interface::get_next_fetch(double &time) const
+{
+	bool found = false;
+	unsigned int i;
+	for(i = 0; i < num_queues; i++)
+		if(!submission[i].empty() && (!found || submission[i].front().arrive_time < time))
+		{
+			time = submission[i].front().arrive_time;
+			found = true;
+		}
+	return found;
+}
+
+/* pass the commands due by time to the drive in arbitration order
+ * stops once a turn of every queue fetches nothing */
+void Host_interface::fetch(double time)
+{
+	unsigned int idle;
+	for(idle = 0; idle < num_queues; next_queue = (next_queue + 1) % num_queues)
+	{
+		std::deque<Request> &queue = submission[next_queue];
+		unsigned int burst = HOST_ARBITRATION == WEIGHTED_ROUND_ROBIN ? weight[next_queue] : 1;
+		unsigned int taken;
+		for(taken = 0; taken < burst && !queue.empty() && queue.front().arrive_time <= time; taken++)
+		{
+			const Request &command = queue.front();
+			unsigned long request = ssd.submit(command.type, command.logical_address, command.size, command.arrive_time);
+			fetched[request] = std::make_pair(next_queue, command.id);
+			queue.pop_front();
+		}
+		idle = taken > 0 ? 0 : idle + 1;
+	}
+	return;
+}
+
+/* move the requests the drive completed to the completion queues they were
+ * submitted from */
+void Host_interface::post(void)
+{
+	Request request;
+	while(ssd.get_completion(request))
+	{
+		std::unordered_map<unsigned long, std::pair<unsigned int, unsigned long> >::iterator it = fetched.find(request.id);
+		assert(it != fetched.end());
+		unsigned int queue = it -> second.first;
+		request.id = it -> second.second;
+		fetched.erase(it);
+		assert(outstanding[queue] > 0);
+		outstanding[queue]--;
+		completion[queue].push_back(request);
+	}
+	return;
+}
@@ -0,0 +1,188 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_mapping_cache.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Mapping_cache class
+ *
+ * Cached mapping table (CMT) of the DFTL scheme.  The cache has a fixed number
+ * of slots.  Slots in use are kept on a doubly linked list from most recently
+ * used (head) to least recently used (tail), and the hash index maps a
+ * logical page to its slot.  Unused slots are the ones numbered used and
+ * above, so filling the cache takes them in order.  size is used as the end
+ * of list marker. */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+Mapping_cache::Mapping_cache(unsigned int size):
+	size(size),
+	used(0),
+	head(size),
+	tail(size),
+
+	/* use const pointers to use as arrays
+	 * but like a reference, we cannot reseat the pointers */
+	logical((unsigned long *) malloc(size * sizeof(unsigned long))),
+	physical((unsigned int *) malloc(size * sizeof(unsigned int))),
+	dirty((bool *) malloc(size * sizeof(bool))),
+	next((unsigned int *) malloc(size * sizeof(unsigned int))),
+	prev((unsigned int *) malloc(size * sizeof(unsigned int))),
+	index(size)
+{
+	assert(size > 0);
+	if(logical == NULL || physical == NULL || dirty == NULL || next == NULL || prev == NULL)
+	{
+		fprintf(stderr, "Mapping_cache error: %s: constructor unable to allocate cache\n", __func__);
+		exit(MEM_ERR);
+	}
+	return;
+}
+
+Mapping_cache::~Mapping_cache(void)
+{
+	free(logical);
+	free(physical);
+	free(dirty);
+	free(next);
+	free(prev);
+	return;
+}
+
+/* a hit makes the mapping the most recently used */
+bool Mapping_cache::lookup(unsigned long logical_page, unsigned int &physical_page)
+{
+	std::unordered_map<unsigned long, unsigned int>::iterator it = index.find(logical_page);
+	if(it == index.end())
+		return false;
+	unlink(it -> second);
+	push_front(it -> second);
+	physical_page = physical[it -> second];
+	return true;
+}
+
+bool Mapping_cache::is_full(void) const
+{
+	return used == size;
+}
+
+/* add a mapping that is not cached as the most recently used
+ * make room with evict first if the cache is full */
+void Mapping_cache::insert(unsigned long logical_page, unsigned int physical_page, bool dirty)
+{
+	assert(used < size && index.count(logical_page) == 0);
+	unsigned int slot = used++;
+	logical[slot] = logical_page;
+	physical[slot] = physical_page;
+	this -> dirty[slot] = dirty;
+	index[logical_page] = slot;
+	push_front(slot);
+	return;
+}
+
+/* change a cached mapping and mark it dirty */
+void Mapping_cache::update(unsigned long logical_page, unsigned int physical_page)
+{
+	std::unordered_map<unsigned long, unsigned int>::iterator it = index.find(logical_page);
+	assert(it != index.end());
+	physical[it -> second] = physical_page;
+	dirty[it -> second] = true;
+	return;
+}
+
+/* the mapping evict would remove */
+void Mapping_cache::get_lru(unsigned long &logical_page, bool &dirty) const
+{
+	assert(used > 0);
+	logical_page = logical[tail];
+	dirty = this -> dirty[tail];
+	return;
+}
+
+/* remove the least recently used mapping
+ * the last slot in use moves into the freed slot so that unused slots stay
+ * at the end */
+void Mapping_cache::evict(void)
+{
+	assert(used > 0);
+	unsigned int slot = tail;
+	unlink(slot);
+	(void) index.erase(logical[slot]);
+
+	unsigned int last = --used;
+	if(slot != last)
+	{
+		bool last_is_head = head == last;
+		bool last_is_tail = tail == last;
+		logical[slot] = logical[last];
+		physical[slot] = physical[last];
+		this -> dirty[slot] = this -> dirty[last];
+		next[slot] = next[last];
+		prev[slot] = prev[last];
+		if(last_is_head)
+			head = slot;
+		else
+			next[prev[slot]] = slot;
+		if(last_is_tail)
+			tail = slot;
+		else
+			prev[next[slot]] = slot;
+		index[logical[slot]] = slot;
+	}
+	return;
+}
+
+/* mark a cached mapping clean when its translation page is written
+ * returns false if the mapping is not cached or already clean */
+bool Mapping_cache::clean(unsigned long logical_page, unsigned int &physical_page)
+{
+	std::unordered_map<unsigned long, unsigned int>::iterator it = index.find(logical_page);
+	if(it == index.end() || !dirty[it -> second])
+		return false;
+	dirty[it -> second] = false;
+	physical_page = physical[it -> second];
+	return true;
+}
+
+void Mapping_cache::unlink(unsigned int slot)
+{
+	if(prev[slot] == size)
+		head = next[slot];
+	else
+		next[prev[slot]] = next[slot];
+	if(next[slot] == size)
+		tail = prev[slot];
+	else
+		prev[next[slot]] = prev[slot];
+	return;
+}
+
+void Mapping_cache::push_front(unsigned int slot)
+{
+	prev[slot] = size;
+	next[slot] = head;
+	if(head == size)
+		tail = slot;
+	else
+		prev[head] = slot;
+	head = slot;
+	return;
+}
@@ -41,7 +41,7 @@ Package::Package(const ssd::Ssd &parent, Channel &channel, unsigned int package_
 	parent(parent),
 
 	/* assume all Dies are same so first one can start as least worn */
-	least_worn(0),
+	wear(size, BLOCK_ERASES),
 
 	/* set erases remaining to BLOCK_ERASES to match Block constructor args 
 	 * in Plane class
@@ -136,31 +136,44 @@ unsigned long Package::get_erases_remaining(const Address &address) const
 		return erases_remaining;
 }
 
-/* Plane with the most erases remaining is the least worn */
+/* Die with the most erases remaining is the least worn
+ * only the die holding the erased block changed, so only its path in the
+ * wear index is replayed */
 void Package::update_wear_stats(const Address &address)
 {
-	unsigned int i;
-	unsigned int max_index = 0;
-	unsigned long max = data[0].get_erases_remaining(address);
-	for(i = 1; i < size; i++)
-		if(data[i].get_erases_remaining(address) > max)
-			max_index = i;
-	least_worn = max_index;
-	erases_remaining = max;
-	last_erase_time = data[max_index].get_last_erase_time(address);
+	assert(data != NULL && address.die < size);
+	wear.update(address.die, data[address.die].get_wear_index());
+	erases_remaining = wear.get_max_erases_remaining();
+	if(data[address.die].get_last_erase_time(address) > last_erase_time)
+		last_erase_time = data[address.die].get_last_erase_time(address);
 	return;
 }
 
-/* update given address -> package to least worn package */
+/* update given address -> die to least worn die */
 void Package::get_least_worn(Address &address) const
 {
-	assert(least_worn < size);
-	address.die = least_worn;
+	assert(data != NULL);
+	address.die = wear.get_least_worn();
+	address.valid = DIE;
+	data[address.die].get_least_worn(address);
+	return;
+}
+
+/* update given address -> die to most worn die */
+void Package::get_most_worn(Address &address) const
+{
+	assert(data != NULL);
+	address.die = wear.get_most_worn();
 	address.valid = DIE;
-	data[least_worn].get_least_worn(address);
+	data[address.die].get_most_worn(address);
 	return;
 }
 
+const Wear_index &Package::get_wear_index(void) const
+{
+	return wear;
+}
+
 enum page_state Package::get_state(const Address &address) const
 {
 	assert(data != NULL && address.die < size && address.valid >= PACKAGE);
@@ -170,7 +183,14 @@ enum page_state Package::get_state(const Address &address) const
 void Package::get_free_page(Address &address) const
 {
 	assert(address.die < size && address.valid >= DIE);
-	data[address.package].get_free_page(address);
+	data[address.die].get_free_page(address);
+	return;
+}
+
+void Package::get_free_block(Address &address) const
+{
+	assert(address.die < size && address.valid >= DIE);
+	data[address.die].get_free_block(address);
 	return;
 }
 unsigned int Package::get_num_free(const Address &address) const
@@ -184,3 +204,32 @@ unsigned int Package::get_num_valid(const Address &address) const
 	assert(address.valid >= DIE);
 	return data[address.die].get_num_valid(address);
 }
+
+/* the fully written block with the fewest valid pages of any die
+ * returns its number of valid pages or BLOCK_SIZE + 1 if there is none */
+unsigned int Package::get_victim(Address &address) const
+{
+	unsigned int i;
+	unsigned int min_valid = BLOCK_SIZE + 1;
+	Address victim(address);
+	for(i = 0; i < size; i++)
+	{
+		address.die = i;
+		address.valid = DIE;
+		unsigned int valid = data[i].get_victim(address);
+		if(valid < min_valid)
+		{
+			min_valid = valid;
+			victim = address;
+		}
+	}
+	address = victim;
+	return min_valid;
+}
+
+void Package::invalidate_page(const Address &address)
+{
+	assert(address.die < size && address.valid >= DIE);
+	data[address.die].invalidate_page(address);
+	return;
+}
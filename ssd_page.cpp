@@ -21,7 +21,12 @@
  * Brendan Tauras 2009-04-06
  *
  * The page is the lowest level data storage unit that is the size unit of
- * requests (events).  Pages maintain their state as events modify them. */
+ * requests (events).  Pages maintain their state as events modify them.
+ *
+ * Page states are kept packed in the page state map of the parent Block
+ * (PAGE_STATE_BITS per page) rather than in one object per page, which keeps
+ * large geometries small enough to simulate.  Read and write delays are the
+ * same for every page and are taken from the global configuration. */
 
 #include <assert.h>
 #include <stdio.h>
@@ -29,36 +34,12 @@
 
 using namespace ssd;
 
-Page::Page(const Block &parent, double read_delay, double write_delay):
-	state(EMPTY),
-	parent(parent),
-	read_delay(read_delay),
-	write_delay(write_delay)
-{
-	state = EMPTY;
-
-	if(read_delay < 0.0){
-		fprintf(stderr, "Page warning: %s: constructor received negative read delay value\n\tsetting read delay to 0.0\n", __func__);
-		this -> read_delay = 0.0;
-	}
-
-	if(write_delay < 0.0){
-		fprintf(stderr, "Page warning: %s: constructor received negative write delay value\n\tsetting write delay to 0.0\n", __func__);
-		this -> write_delay = 0.0;
-	}
-	return;
-}
-
-Page::~Page(void)
+/* check that the page can be read and add the page read delay to the event */
+enum status Page::_read(enum page_state state, Event &event)
 {
-	return;
-}
-
-enum status Page::_read(Event &event)
-{
-	assert(read_delay >= 0.0);
+	assert(PAGE_READ_DELAY >= 0.0);
 	if(state == VALID){
-		event.incr_time_taken(read_delay);
+		event.incr_time_taken(PAGE_READ_DELAY);
 		return SUCCESS;
 	} else {
     fprintf(stderr, "Trying to read invalid page\n");
@@ -66,12 +47,14 @@ enum status Page::_read(Event &event)
   }
 }
 
-enum status Page::_write(Event &event)
+/* check that the page can be written and add the page write delay to the
+ * event
+ * the caller is responsible for setting the page state to valid */
+enum status Page::_write(enum page_state state, Event &event)
 {
-	assert(write_delay >= 0.0);
+	assert(PAGE_WRITE_DELAY >= 0.0);
 	if(state == EMPTY){
-		event.incr_time_taken(write_delay);
-		state = VALID;
+		event.incr_time_taken(PAGE_WRITE_DELAY);
 		return SUCCESS;
 	} else {
     fprintf(stderr, "Trying to write invalid page\n");
@@ -79,18 +62,49 @@ enum status Page::_write(Event &event)
   }
 }
 
-const Block &Page::get_parent(void) const
+enum page_state Page::get_state(const unsigned long *map, unsigned int page)
 {
-	return parent;
+	return (enum page_state) ((map[page / PAGES_PER_WORD] >> ((page % PAGES_PER_WORD) * PAGE_STATE_BITS)) & PAGE_STATE_MASK);
 }
 
-enum page_state Page::get_state(void) const
+void Page::set_state(unsigned long *map, unsigned int page, enum page_state state)
 {
-	return state;
+	unsigned int shift = (page % PAGES_PER_WORD) * PAGE_STATE_BITS;
+	unsigned long &word = map[page / PAGES_PER_WORD];
+	word = (word & ~(PAGE_STATE_MASK << shift)) | ((unsigned long) state << shift);
+	return;
 }
 
-void Page::set_state(enum page_state state)
+/* find the first empty page at or after start in a map of size pages
+ * EMPTY is stored as 0, so a word is searched at once by folding each page
+ * state onto its low bit and looking for the first clear low bit
+ * returns size if there is no empty page */
+unsigned int Page::find_empty(const unsigned long *map, unsigned int start, unsigned int size)
 {
-	this -> state = state;
-	return;
+	/* low bit of every page state in a word */
+	const unsigned long low_bits = ~0UL / PAGE_STATE_MASK;
+	unsigned int word;
+	unsigned long empty;
+
+	assert(EMPTY == 0);
+	for(word = start / PAGES_PER_WORD; word * PAGES_PER_WORD < size; word++)
+	{
+		empty = ~(map[word] | (map[word] >> 1)) & low_bits;
+
+		/* ignore pages before start in the first word searched */
+		if(word == start / PAGES_PER_WORD)
+			empty &= ~0UL << ((start % PAGES_PER_WORD) * PAGE_STATE_BITS);
+		if(empty != 0)
+		{
+			start = word * PAGES_PER_WORD + __builtin_ctzl(empty) / PAGE_STATE_BITS;
+			return start < size ? start : size;
+		}
+	}
+	return size;
+}
+
+/* number of words needed to hold the states of size pages */
+unsigned int Page::get_map_words(unsigned int size)
+{
+	return (size + PAGES_PER_WORD - 1) / PAGES_PER_WORD;
 }
@@ -0,0 +1,780 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_page_ftl.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Page_ftl class
+ *
+ * Page-level mapping FTL.  The Ftl creates one when FTL_IMPLEMENTATION is set
+ * to PAGE_MAPPED or DFTL and hands it every read and write to translate.
+ *
+ * Physical page numbers are composed with the global GEOMETRY, so the pages
+ * of block b of the whole drive are b * BLOCK_SIZE to (b + 1) * BLOCK_SIZE - 1
+ * and the blocks of plane p are p * PLANE_SIZE to (p + 1) * PLANE_SIZE - 1.
+ * The p2l array plays the part of the out-of-band area of each physical page
+ * and holds its owner: a logical page, or num_logical_pages plus the number
+ * of a translation page.
+ *
+ * PAGE_MAPPED keeps the whole L2P table in the l2p array.  DFTL keeps it in
+ * translation pages of DFTL_ENTRIES_PER_PAGE entries each.  The global
+ * translation directory (gtd) holds the physical page of each translation
+ * page and translation_pages holds their contents, allocated the first time
+ * each one is written.  Only the cached mapping table is controller RAM.
+ *
+ * Writes take the write frontier of the next plane in round-robin order.
+ * With STREAM_SEPARATION, host writes are split by the update count of their
+ * logical page, which is halved every time the host writes a
+ * PAGE_FTL_HEAT_DECAY-th of the logical pages: hot pages take the write
+ * frontier of the plane, while warm and cold pages each fill an open block of
+ * their own in every plane.  Cleaning puts relocated pages that are still hot
+ * or warm back in their stream and the rest in a cleaning stream of their own.
+ * Pages that are rewritten at about the same rate then share blocks, which
+ * are mostly invalid by the time they are cleaned, while cold pages are not
+ * copied over and over along with the hot ones.
+ * Before a host write the drive is cleaned until it has more than
+ * PAGE_FTL_FREE_BLOCKS free blocks.  With GC_STEP_PAGES set, cleaning starts
+ * earlier, below the GC_STEP_WATERMARK, and each write only relocates
+ * GC_STEP_PAGES pages of the block being cleaned or erases it, which bounds
+ * the time a write waits for cleaning.  When the drive is idle long enough
+ * (GC_IDLE_THRESHOLD) it is also cleaned in the background up to the
+ * GC_IDLE_WATERMARK, so that host writes rarely wait for cleaning.
+ * With THROTTLE_DELAY set, host writes are held while free blocks run low and
+ * the drive cleans a page at a time meanwhile (see Ftl::throttle).
+ *
+ * Cleaning relocates valid pages with copyback merges to the frontier of the
+ * same plane, or another plane of the same die, so they do not cross the
+ * channel.  A die without free pages relocates them to the frontiers of any
+ * plane, so the overprovisioned space of the whole drive is shared rather
+ * than split between planes.  The block to clean is picked
+ * with SELECTED_GC_POLICY among the full blocks with an invalid page:
+ * 	FIFO: the block that was filled first
+ * 	LRU: the block whose pages were written or invalidated least recently
+ * 	GREEDY: the block with the fewest valid pages, read from the victim
+ * 		indexes of the planes
+ * 	COST_BENEFIT: the block with the highest (1 - u) * age / (1 + u), where
+ * 		u is the fraction of valid pages and age is the time since the
+ * 		block was erased
+ * For the other policies the full blocks are kept in a Policy_index: FIFO and
+ * LRU order them on the time they were filled or last used, with the blocks
+ * that have an invalid page in the first bucket, and COST_BENEFIT buckets
+ * them by valid pages in the order they were erased, so that only the oldest
+ * block of each bucket is weighed.
+ *
+ * Mapping table accesses cost RAM_READ_DELAY or RAM_WRITE_DELAY, and flash
+ * operations done on behalf of a request (cleaning and translation pages)
+ * run one after the other ahead of it, so their time is added to the
+ * request's time taken. */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ssd.h"
+
+/* marks an unmapped entry in the mapping tables */
+#define PAGE_FTL_UNMAPPED (~0U)
+
+/* free blocks the drive keeps in reserve before host writes */
+#define PAGE_FTL_FREE_BLOCKS 1
+
+/* mapping entries per DFTL translation page (4-byte entries in 2KB) */
+#define DFTL_ENTRIES_PER_PAGE 512
+
+/* write streams with STREAM_SEPARATION
+ * the hot stream takes the write frontier of the plane */
+#define PAGE_FTL_HOT_STREAM 0
+#define PAGE_FTL_WARM_STREAM 1
+#define PAGE_FTL_COLD_STREAM 2
+#define PAGE_FTL_GC_STREAM 3
+#define PAGE_FTL_STREAMS 4
+
+/* update counts from which a logical page is warm and hot */
+#define PAGE_FTL_WARM_HEAT 2
+#define PAGE_FTL_HOT_HEAT 4
+
+/* update counts are halved each time the host writes this fraction of the
+ * logical pages */
+#define PAGE_FTL_HEAT_DECAY 2
+
+using namespace ssd;
+
+Page_ftl::Page_ftl(Ftl &ftl, FILE *log_file):
+	ftl(ftl),
+	log_file(log_file),
+
+	/* overprovisioned blocks are not visible to the host */
+	num_logical_pages((GEOMETRY.get_num_blocks() - (unsigned long) ((OVERPROVISIONING / 100) * GEOMETRY.get_num_blocks())) * BLOCK_SIZE),
+	num_translation_pages((num_logical_pages + DFTL_ENTRIES_PER_PAGE - 1) / DFTL_ENTRIES_PER_PAGE),
+	free_blocks(GEOMETRY.get_num_blocks()),
+	num_planes(SSD_SIZE * PACKAGE_SIZE * DIE_SIZE),
+	next_plane(0),
+
+	/* use const pointers to use as arrays
+	 * but like references, we cannot reseat the pointers */
+	l2p(FTL_IMPLEMENTATION == DFTL ? NULL : (unsigned int *) malloc(num_logical_pages * sizeof(unsigned int))),
+	p2l((unsigned int *) malloc(GEOMETRY.get_num_pages() * sizeof(unsigned int))),
+	block_valid((unsigned int *) calloc(GEOMETRY.get_num_blocks(), sizeof(unsigned int))),
+	block_written((unsigned int *) calloc(GEOMETRY.get_num_blocks(), sizeof(unsigned int))),
+	block_filled((unsigned long *) calloc(GEOMETRY.get_num_blocks(), sizeof(unsigned long))),
+	block_used((unsigned long *) calloc(GEOMETRY.get_num_blocks(), sizeof(unsigned long))),
+	num_updates(0),
+	victims(BLOCK_SIZE),
+	victim(GEOMETRY.get_num_blocks()),
+	victim_page(0),
+	cache(FTL_IMPLEMENTATION == DFTL ? (Mapping_cache *) malloc(sizeof(Mapping_cache)) : NULL),
+	gtd(FTL_IMPLEMENTATION == DFTL ? (unsigned int *) malloc(num_translation_pages * sizeof(unsigned int)) : NULL),
+	translation_pages(FTL_IMPLEMENTATION == DFTL ? (unsigned int **) calloc(num_translation_pages, sizeof(unsigned int *)) : NULL),
+	stream_page(STREAM_SEPARATION ? (unsigned int *) malloc(num_planes * PAGE_FTL_STREAMS * sizeof(unsigned int)) : NULL),
+	heat(STREAM_SEPARATION ? (unsigned char *) calloc(num_logical_pages, sizeof(unsigned char)) : NULL),
+	heat_period(STREAM_SEPARATION ? (unsigned char *) calloc(num_logical_pages, sizeof(unsigned char)) : NULL),
+	period(0),
+	period_writes(0)
+{
+	/* physical page numbers and owners must fit in an array entry */
+	assert(GEOMETRY.get_num_pages() < PAGE_FTL_UNMAPPED && num_logical_pages + num_translation_pages < PAGE_FTL_UNMAPPED);
+
+	if(p2l == NULL || block_valid == NULL || block_written == NULL || block_filled == NULL || block_used == NULL
+		|| (FTL_IMPLEMENTATION == DFTL ? cache == NULL || gtd == NULL || translation_pages == NULL : l2p == NULL)
+		|| (STREAM_SEPARATION && (stream_page == NULL || heat == NULL || heat_period == NULL)))
+	{
+		fprintf(stderr, "Page_ftl error: %s: constructor unable to allocate mapping tables\n", __func__);
+		exit(MEM_ERR);
+	}
+
+	/* every byte of an unmapped entry is 0xff */
+	(void) memset(p2l, 0xff, GEOMETRY.get_num_pages() * sizeof(unsigned int));
+	if(FTL_IMPLEMENTATION == DFTL)
+	{
+		(void) new (cache) Mapping_cache(MAP_CACHE_SIZE);
+		(void) memset(gtd, 0xff, num_translation_pages * sizeof(unsigned int));
+	}
+	else
+		(void) memset(l2p, 0xff, num_logical_pages * sizeof(unsigned int));
+
+	/* no stream has an open block yet */
+	if(stream_page != NULL)
+		(void) memset(stream_page, 0xff, num_planes * PAGE_FTL_STREAMS * sizeof(unsigned int));
+	return;
+}
+
+Page_ftl::~Page_ftl(void)
+{
+	unsigned long i;
+	if(cache != NULL)
+	{
+		cache -> ~Mapping_cache();
+		free(cache);
+		for(i = 0; i < num_translation_pages; i++)
+			free(translation_pages[i]);
+	}
+	free(translation_pages);
+	free(gtd);
+	free(l2p);
+	free(p2l);
+	free(block_valid);
+	free(block_written);
+	free(block_filled);
+	free(block_used);
+	free(stream_page);
+	free(heat);
+	free(heat_period);
+	return;
+}
+
+enum status Page_ftl::translate(Event &event)
+{
+	if(event.get_logical_address() >= num_logical_pages)
+		return FAILURE;
+	if(event.get_event_type() == READ)
+		return read(event);
+	else if(event.get_event_type() == WRITE)
+		return write(event);
+	return FAILURE;
+}
+
+/* pages that were never written have no physical page to read */
+enum status Page_ftl::read(Event &event)
+{
+	unsigned int physical_page;
+	Address address;
+
+	if(get_mapping(event, event.get_logical_address(), physical_page) == FAILURE
+		|| physical_page == PAGE_FTL_UNMAPPED)
+		return FAILURE;
+	GEOMETRY.decompose(physical_page, address);
+	address.valid = PAGE;
+	event.set_address(address);
+	return SUCCESS;
+}
+
+enum status Page_ftl::write(Event &event)
+{
+	unsigned int old_page;
+	unsigned int new_page;
+	unsigned int stream = select_stream(event.get_logical_address());
+	Address address;
+
+	/* once free blocks run low, every write takes a step of cleaning a block
+	 * and a block is cleaned completely only when the drive runs out */
+	unsigned long step_blocks = (unsigned long) ((GC_STEP_WATERMARK / 100) * (GEOMETRY.get_num_blocks() - num_logical_pages / BLOCK_SIZE));
+	if(GC_STEP_PAGES > 0 && (victim != GEOMETRY.get_num_blocks() || free_blocks <= step_blocks)
+		&& start_cleaning(event) == SUCCESS && clean_step(event, GC_STEP_PAGES) == FAILURE)
+		return FAILURE;
+	while(free_blocks <= PAGE_FTL_FREE_BLOCKS && collect(event) == SUCCESS)
+		;
+	if(get_mapping(event, event.get_logical_address(), old_page) == FAILURE
+		|| allocate(address, stream) == FAILURE)
+		return FAILURE;
+	new_page = GEOMETRY.compose(address);
+	map_physical(event.get_logical_address(), old_page, new_page);
+	if(set_mapping(event, event.get_logical_address(), new_page) == FAILURE)
+		return FAILURE;
+	event.set_address(address);
+	return SUCCESS;
+}
+
+/* count a host write of a logical page and pick the stream it is written to */
+unsigned int Page_ftl::select_stream(unsigned long logical_page)
+{
+	if(heat == NULL)
+		return PAGE_FTL_HOT_STREAM;
+	if(++period_writes >= num_logical_pages / PAGE_FTL_HEAT_DECAY)
+	{
+		period++;
+		period_writes = 0;
+
+		/* only the low byte of the period is kept for each page, so every
+		 * count is brought up to date before it wraps around, which makes
+		 * this take constant time per write on average
+		 * a page last looked at when the low byte was last 0 is 256
+		 * periods old and has gone cold, though its age would read 0 */
+		if((unsigned char) period == 0)
+			for(unsigned long i = 0; i < num_logical_pages; i++)
+			{
+				if(heat_period[i] == 0)
+					heat[i] = 0;
+				else
+					get_heat(i);
+			}
+	}
+	unsigned int count = get_heat(logical_page);
+	if(count < 0xff)
+		heat[logical_page] = ++count;
+
+	if(count >= PAGE_FTL_HOT_HEAT)
+		return PAGE_FTL_HOT_STREAM;
+	else if(count >= PAGE_FTL_WARM_HEAT)
+		return PAGE_FTL_WARM_STREAM;
+	return PAGE_FTL_COLD_STREAM;
+}
+
+/* pick the stream a page relocated by cleaning is written to
+ * a logical page that is still hot or warm goes back to its stream, so that
+ * the cleaning stream gathers the pages that outlived their blocks */
+unsigned int Page_ftl::select_relocation_stream(unsigned long owner)
+{
+	if(heat == NULL || owner >= num_logical_pages)
+		return PAGE_FTL_GC_STREAM;
+	unsigned int count = get_heat(owner);
+	if(count >= PAGE_FTL_HOT_HEAT)
+		return PAGE_FTL_HOT_STREAM;
+	else if(count >= PAGE_FTL_WARM_HEAT)
+		return PAGE_FTL_WARM_STREAM;
+	return PAGE_FTL_GC_STREAM;
+}
+
+/* update count of a logical page in the current period
+ * a count is brought up to date with the periods that passed since it was
+ * last looked at, so decaying the counts takes constant time
+ * no count is more than 256 periods old, see select_stream() */
+unsigned int Page_ftl::get_heat(unsigned long logical_page)
+{
+	unsigned char age = (unsigned char) period - heat_period[logical_page];
+	heat[logical_page] = age >= 8 ? 0 : heat[logical_page] >> age;
+	heat_period[logical_page] = (unsigned char) period;
+	return heat[logical_page];
+}
+
+/* find a free page for the stream in the next plane that has one
+ * planes are tried in round-robin order starting with next_plane */
+enum status Page_ftl::allocate(Address &address, unsigned int stream)
+{
+	unsigned int i;
+	for(i = 0; i < (stream_page == NULL ? num_planes : 2 * num_planes); i++)
+	{
+		GEOMETRY.decompose((unsigned long) next_plane * PLANE_SIZE * BLOCK_SIZE, address);
+		address.valid = PLANE;
+		next_plane = (next_plane + 1) % num_planes;
+
+		if((i < num_planes ? take_page(address, stream) : allocate_plane(address, stream)) == SUCCESS)
+			return SUCCESS;
+	}
+	fprintf(log_file, "Page_ftl: %s: no free pages left\n", __func__);
+	return FAILURE;
+}
+
+/* find a free page for the stream in the plane given by the address
+ * a plane without a free block for the stream hands out the free pages of
+ * the other streams, so that no free page of the plane goes unused */
+enum status Page_ftl::allocate_plane(Address &address, unsigned int stream)
+{
+	unsigned int num_streams = stream_page == NULL ? 1 : PAGE_FTL_STREAMS;
+	unsigned int i;
+	for(i = 0; i < num_streams; i++)
+	{
+		address.valid = PLANE;
+		if(take_page(address, (stream + i) % num_streams) == SUCCESS)
+			return SUCCESS;
+	}
+	return FAILURE;
+}
+
+/* take the next free page of a stream in the plane given by the address
+ * the hot stream, and every stream without STREAM_SEPARATION, takes the
+ * write frontier of the plane and the others take
+ * the next page of their open block, opening the least worn free block of
+ * the plane once it is full
+ * an opened block stays one of the free blocks of the plane until its first
+ * page is written, which happens before the next page is allocated */
+enum status Page_ftl::take_page(Address &address, unsigned int stream)
+{
+	if(stream_page == NULL || stream == PAGE_FTL_HOT_STREAM)
+	{
+		ftl.get_free_page(address);
+		return address.valid == PAGE ? SUCCESS : FAILURE;
+	}
+
+	unsigned int plane = (address.package * PACKAGE_SIZE + address.die) * DIE_SIZE + address.plane;
+	unsigned int &next = stream_page[plane * PAGE_FTL_STREAMS + stream];
+	if(next == PAGE_FTL_UNMAPPED)
+	{
+		ftl.get_free_block(address);
+		if(address.valid < PAGE)
+			return FAILURE;
+		next = GEOMETRY.compose(address);
+	}
+	else
+	{
+		GEOMETRY.decompose(next, address);
+		address.valid = PAGE;
+	}
+	next = GEOMETRY.get_page(next + 1) == 0 ? PAGE_FTL_UNMAPPED : next + 1;
+	return SUCCESS;
+}
+
+/* clean while the drive is idle until watermark percent of the
+ * overprovisioned blocks are free or idle_time has passed since the start of
+ * the event
+ * a block that is started is cleaned completely, so the event can take
+ * longer than idle_time
+ * returns the number of blocks cleaned */
+unsigned int Page_ftl::collect_idle(Event &event, double idle_time, float watermark)
+{
+	unsigned int cleaned = 0;
+	while(event.get_time_taken() < idle_time && collect_idle_step(event, watermark) > 0)
+		cleaned++;
+	return cleaned;
+}
+
+/* clean one block in the background if fewer than watermark percent of the
+ * overprovisioned blocks are free
+ * returns the number of blocks cleaned */
+unsigned int Page_ftl::collect_idle_step(Event &event, float watermark)
+{
+	unsigned long reserve = GEOMETRY.get_num_blocks() - num_logical_pages / BLOCK_SIZE;
+	unsigned long target = (unsigned long) ((watermark / 100) * reserve);
+
+	if(free_blocks < target && collect(event) == SUCCESS)
+		return 1;
+	return 0;
+}
+
+/* clean a page at a time for a throttled write until watermark percent of the
+ * overprovisioned blocks are free or hold has passed since the start of the
+ * event
+ * unlike collect_idle, a block can be left partly cleaned, so the event takes
+ * no longer than hold plus one page or erase */
+void Page_ftl::collect_throttled(Event &event, double hold, float watermark)
+{
+	unsigned long reserve = GEOMETRY.get_num_blocks() - num_logical_pages / BLOCK_SIZE;
+	unsigned long target = (unsigned long) ((watermark / 100) * reserve);
+
+	while(event.get_time_taken() < hold && (victim != GEOMETRY.get_num_blocks() || free_blocks < target)
+		&& start_cleaning(event) == SUCCESS && clean_step(event, 1) == SUCCESS)
+		;
+	return;
+}
+
+/* percentage of the overprovisioned blocks that are free */
+double Page_ftl::get_free_reserve(void) const
+{
+	unsigned long reserve = GEOMETRY.get_num_blocks() - num_logical_pages / BLOCK_SIZE;
+	return 100.0 * free_blocks / reserve;
+}
+
+/* static wear leveling: clean the given block, usually the least worn one,
+ * even if all of its pages are valid, so that its cold data moves to the
+ * write frontiers and the block is reused for hot data
+ * a block being cleaned is finished first
+ * fails if the block is not fully written or free space runs low */
+enum status Page_ftl::migrate(Event &event, const Address &block)
+{
+	unsigned long num_blocks = GEOMETRY.get_num_blocks();
+	if(victim != num_blocks && collect(event) == FAILURE)
+		return FAILURE;
+
+	unsigned long cold = GEOMETRY.get_block(GEOMETRY.compose(block));
+	if(block_written[cold] != BLOCK_SIZE || free_blocks <= PAGE_FTL_FREE_BLOCKS)
+		return FAILURE;
+	victim = cold;
+	victim_page = cold * BLOCK_SIZE;
+	while(victim != num_blocks)
+		if(clean_step(event, BLOCK_SIZE) == FAILURE)
+			return FAILURE;
+	return SUCCESS;
+}
+
+/* pick the block to clean with SELECTED_GC_POLICY
+ * only a full block with at least one invalid page makes progress
+ * returns the number of blocks if there is no such block */
+unsigned long Page_ftl::select_victim(Event &event)
+{
+	unsigned long num_blocks = GEOMETRY.get_num_blocks();
+	unsigned long victim = num_blocks;
+	unsigned long block;
+	Address address;
+
+	if(SELECTED_GC_POLICY == GREEDY)
+	{
+		unsigned int valid = ftl.get_victim(address);
+		if(valid >= BLOCK_SIZE)
+			return num_blocks;
+		victim = GEOMETRY.get_block(GEOMETRY.compose(address));
+		assert(block_written[victim] == BLOCK_SIZE && block_valid[victim] == valid);
+		return victim;
+	}
+
+	if(SELECTED_GC_POLICY == FIFO || SELECTED_GC_POLICY == LRU)
+	{
+		if(!victims.get_first(0, block))
+			return num_blocks;
+		assert(block_written[block] == BLOCK_SIZE && block_valid[block] < BLOCK_SIZE);
+		return block;
+	}
+
+	/* the block erased first has the highest benefit of its bucket */
+	double now = event.get_start_time() + event.get_time_taken();
+	double best = 0.0;
+	unsigned int valid;
+	for(valid = 0; valid < BLOCK_SIZE; valid++)
+	{
+		if(!victims.get_first(valid, block))
+			continue;
+		double utilization = (double) valid / BLOCK_SIZE;
+		double benefit = (1 - utilization) * (now - victims.get_order(block)) / (1 + utilization);
+		if(victim == num_blocks || benefit > best || (benefit == best && block < victim))
+		{
+			victim = block;
+			best = benefit;
+		}
+	}
+	return victim;
+}
+
+/* add a fully written block to the victim index of SELECTED_GC_POLICY, or
+ * rekey it after one of its pages was invalidated */
+void Page_ftl::index_victim(unsigned long block)
+{
+	unsigned int key;
+	double order;
+	if(SELECTED_GC_POLICY == GREEDY)
+		return;
+	if(SELECTED_GC_POLICY == COST_BENEFIT)
+	{
+		key = block_valid[block];
+		if(victims.contains(block))
+			order = victims.get_order(block);
+		else
+		{
+			Address address;
+			GEOMETRY.decompose(block * BLOCK_SIZE, address);
+			address.valid = BLOCK;
+			order = ftl.get_last_erase_time(address);
+		}
+	}
+	else
+	{
+		key = block_valid[block] < BLOCK_SIZE ? 0 : 1;
+		order = SELECTED_GC_POLICY == FIFO ? block_filled[block] : block_used[block];
+	}
+	if(victims.contains(block))
+		victims.update(block, key, order);
+	else
+		victims.insert(block, key, order);
+	return;
+}
+
+/* clean one block, finishing the block being cleaned if there is one */
+enum status Page_ftl::collect(Event &event)
+{
+	if(start_cleaning(event) == FAILURE)
+		return FAILURE;
+	while(victim != GEOMETRY.get_num_blocks())
+		if(clean_step(event, BLOCK_SIZE) == FAILURE)
+			return FAILURE;
+	return SUCCESS;
+}
+
+/* pick a block to clean unless one is being cleaned
+ * returns FAILURE if there is no block to clean */
+enum status Page_ftl::start_cleaning(Event &event)
+{
+	if(victim != GEOMETRY.get_num_blocks())
+		return SUCCESS;
+	victim = select_victim(event);
+	if(victim == GEOMETRY.get_num_blocks())
+		return FAILURE;
+	victim_page = victim * BLOCK_SIZE;
+	return SUCCESS;
+}
+
+/* relocate up to max_pages valid pages of the block being cleaned, or erase
+ * it once it has none left
+ * valid pages are relocated one at a time, so a failure part way through
+ * leaves every logical page mapped to a valid copy */
+enum status Page_ftl::clean_step(Event &event, unsigned int max_pages)
+{
+	assert(victim != GEOMETRY.get_num_blocks());
+	if(block_valid[victim] > 0)
+	{
+		unsigned int copied = 0;
+		for(; victim_page < (victim + 1) * BLOCK_SIZE && block_valid[victim] > 0 && copied < max_pages; victim_page++)
+		{
+			unsigned int owner = p2l[victim_page];
+			if(owner == PAGE_FTL_UNMAPPED)
+				continue;
+
+			Address source;
+			Address target;
+			GEOMETRY.decompose(victim_page, source);
+			source.valid = PAGE;
+			if(relocate(event, owner, source, target) == FAILURE)
+				return FAILURE;
+
+			unsigned int new_page = GEOMETRY.compose(target);
+			map_physical(owner, victim_page, new_page);
+			if(owner >= num_logical_pages)
+				gtd[owner - num_logical_pages] = new_page;
+			else if(set_mapping(event, owner, new_page) == FAILURE)
+				return FAILURE;
+			copied++;
+		}
+		return SUCCESS;
+	}
+
+	Address address;
+	GEOMETRY.decompose(victim * BLOCK_SIZE, address);
+	address.valid = BLOCK;
+	if(issue(event, ERASE, victim * BLOCK_SIZE, address) == FAILURE)
+		return FAILURE;
+	block_written[victim] = 0;
+	if(victims.contains(victim))
+		victims.remove(victim);
+	free_blocks++;
+	fprintf(log_file, "Page_ftl: %s: erased block %lu\n", __func__, victim);
+	victim = GEOMETRY.get_num_blocks();
+	return SUCCESS;
+}
+
+/* copy a valid page for cleaning to the stream select_relocation_stream picks
+ * a free page in the die of the source, preferably in its plane, takes a
+ * copyback merge that stays inside the die, and otherwise the page is read
+ * and written through the controller to the next plane that has one */
+enum status Page_ftl::relocate(Event &event, unsigned int owner, const Address &source, Address &target)
+{
+	unsigned int stream = select_relocation_stream(owner);
+	unsigned int i;
+	for(i = 0; i < DIE_SIZE; i++)
+	{
+		target = source;
+		target.plane = (source.plane + i) % DIE_SIZE;
+		target.valid = PLANE;
+		if(allocate_plane(target, stream) == SUCCESS)
+		{
+			Event internal(MERGE, owner, 1, event.get_start_time() + event.get_time_taken());
+			internal.set_address(source);
+			internal.set_merge_address(target);
+			enum status status = ftl.controller.issue(internal);
+			(void) event.incr_time_taken(internal.get_time_taken());
+			(void) event.incr_bus_wait_time(internal.get_bus_wait_time());
+			return status;
+		}
+	}
+
+	if(allocate(target, stream) == FAILURE
+		|| issue(event, READ, owner, source) == FAILURE
+		|| issue(event, WRITE, owner, target) == FAILURE)
+		return FAILURE;
+	return SUCCESS;
+}
+
+/* issue a single page operation on behalf of a request
+ * the operation starts when the request's previous work is done and its time
+ * and bus wait are added to the request */
+enum status Page_ftl::issue(Event &event, enum event_type type, unsigned long logical_address, const Address &address)
+{
+	Event internal(type, logical_address, 1, event.get_start_time() + event.get_time_taken());
+	internal.set_address(address);
+	enum status status = ftl.controller.issue(internal);
+	(void) event.incr_time_taken(internal.get_time_taken());
+	(void) event.incr_bus_wait_time(internal.get_bus_wait_time());
+	return status;
+}
+
+/* look up the physical page of a logical page
+ * a DFTL cache miss first makes room in the cache, writing back the
+ * translation page of the mapping to evict if it is dirty, then reads the
+ * translation page holding the mapping unless it was never written */
+enum status Page_ftl::get_mapping(Event &event, unsigned long logical_page, unsigned int &physical_page)
+{
+	(void) event.incr_time_taken(RAM_READ_DELAY);
+	if(cache == NULL)
+	{
+		physical_page = l2p[logical_page];
+		return SUCCESS;
+	}
+	if(cache -> lookup(logical_page, physical_page))
+		return SUCCESS;
+
+	if(cache -> is_full())
+	{
+		unsigned long evicted;
+		bool dirty;
+		cache -> get_lru(evicted, dirty);
+		if(dirty && write_translation_page(event, evicted / DFTL_ENTRIES_PER_PAGE) == FAILURE)
+			return FAILURE;
+		cache -> evict();
+	}
+
+	unsigned long translation_page = logical_page / DFTL_ENTRIES_PER_PAGE;
+	physical_page = PAGE_FTL_UNMAPPED;
+	if(gtd[translation_page] != PAGE_FTL_UNMAPPED)
+	{
+		Address address;
+		GEOMETRY.decompose(gtd[translation_page], address);
+		address.valid = PAGE;
+		if(issue(event, READ, num_logical_pages + translation_page, address) == FAILURE)
+			return FAILURE;
+		physical_page = translation_pages[translation_page][logical_page % DFTL_ENTRIES_PER_PAGE];
+	}
+	cache -> insert(logical_page, physical_page, false);
+	(void) event.incr_time_taken(RAM_WRITE_DELAY);
+	return SUCCESS;
+}
+
+/* point a logical page at a new physical page in the mapping table
+ * a DFTL mapping is loaded into the cache first if it is not cached */
+enum status Page_ftl::set_mapping(Event &event, unsigned long logical_page, unsigned int physical_page)
+{
+	unsigned int old_page;
+	if(cache == NULL)
+	{
+		(void) event.incr_time_taken(RAM_WRITE_DELAY);
+		l2p[logical_page] = physical_page;
+		return SUCCESS;
+	}
+	if(get_mapping(event, logical_page, old_page) == FAILURE)
+		return FAILURE;
+	(void) event.incr_time_taken(RAM_WRITE_DELAY);
+	cache -> update(logical_page, physical_page);
+	return SUCCESS;
+}
+
+/* write a translation page out of place with the dirty cached mappings it
+ * holds, which become clean
+ * the old copy is read first since the rest of its entries are kept */
+enum status Page_ftl::write_translation_page(Event &event, unsigned long translation_page)
+{
+	Address address;
+	unsigned long owner = num_logical_pages + translation_page;
+	unsigned long first = translation_page * DFTL_ENTRIES_PER_PAGE;
+	unsigned long logical_page;
+	unsigned int physical_page;
+
+	if(translation_pages[translation_page] == NULL)
+	{
+		translation_pages[translation_page] = (unsigned int *) malloc(DFTL_ENTRIES_PER_PAGE * sizeof(unsigned int));
+		if(translation_pages[translation_page] == NULL)
+		{
+			fprintf(stderr, "Page_ftl error: %s: unable to allocate translation page\n", __func__);
+			exit(MEM_ERR);
+		}
+		(void) memset(translation_pages[translation_page], 0xff, DFTL_ENTRIES_PER_PAGE * sizeof(unsigned int));
+	}
+
+	if(gtd[translation_page] != PAGE_FTL_UNMAPPED)
+	{
+		GEOMETRY.decompose(gtd[translation_page], address);
+		address.valid = PAGE;
+		if(issue(event, READ, owner, address) == FAILURE)
+			return FAILURE;
+	}
+
+	for(logical_page = first; logical_page < first + DFTL_ENTRIES_PER_PAGE && logical_page < num_logical_pages; logical_page++)
+		if(cache -> clean(logical_page, physical_page))
+			translation_pages[translation_page][logical_page - first] = physical_page;
+
+	if(allocate(address, PAGE_FTL_HOT_STREAM) == FAILURE || issue(event, WRITE, owner, address) == FAILURE)
+		return FAILURE;
+	physical_page = GEOMETRY.compose(address);
+	map_physical(owner, gtd[translation_page], physical_page);
+	gtd[translation_page] = physical_page;
+	return SUCCESS;
+}
+
+/* record that the owner was written to a new physical page
+ * the old physical page of the owner, if any, becomes invalid */
+void Page_ftl::map_physical(unsigned long owner, unsigned int old_page, unsigned int new_page)
+{
+	unsigned long block;
+	Address address;
+	if(old_page != PAGE_FTL_UNMAPPED)
+	{
+		block = GEOMETRY.get_block(old_page);
+		p2l[old_page] = PAGE_FTL_UNMAPPED;
+		block_valid[block]--;
+		block_used[block] = ++num_updates;
+		if(block_written[block] == BLOCK_SIZE)
+			index_victim(block);
+		GEOMETRY.decompose(old_page, address);
+		address.valid = PAGE;
+		ftl.invalidate_page(address);
+	}
+	block = GEOMETRY.get_block(new_page);
+	p2l[new_page] = owner;
+	block_valid[block]++;
+	block_used[block] = ++num_updates;
+	if(block_written[block]++ == 0)
+		free_blocks--;
+	if(block_written[block] == BLOCK_SIZE)
+	{
+		block_filled[block] = num_updates;
+		index_victim(block);
+	}
+	return;
+}
@@ -41,7 +41,14 @@ Plane::Plane(const Die &parent, unsigned int plane_size, double reg_read_delay,
 	parent(parent),
 
 	/* assume all Blocks are same so first one can start as least worn */
-	least_worn(0),
+	wear(size, BLOCK_ERASES),
+
+	/* free blocks are keyed on one more than their erases remaining and the
+	 * other blocks on 0, so the least worn free block wins
+	 * no block is free until the loop in the constructor body */
+	free_wear(size, 0),
+
+	victims(size, BLOCK_SIZE),
 
 	/* set erases remaining to BLOCK_ERASES to match Block constructor args */
 	erases_remaining(BLOCK_ERASES),
@@ -92,6 +99,11 @@ Plane::Plane(const Die &parent, unsigned int plane_size, double reg_read_delay,
 	for(i = 0; i < size; i++)
 		(void) new (&data[i]) Block(*this, BLOCK_SIZE, BLOCK_ERASES, BLOCK_ERASE_DELAY);
 
+	/* all blocks start free
+	 * the first one is not added to the free blocks as it holds the next page */
+	for(i = 1; i < size; i++)
+		add_free_block(i);
+
 	return;
 }
 
@@ -113,33 +125,67 @@ enum status Plane::read(Event &event)
 	return data[event.get_address().block].read(event);
 }
 
+/* if no errors
+ * 	takes a written free block out of the free blocks
+ * 	moves next_page to the next page of its block or to the next free block
+ * returns 1 for success, 0 for failure */
 enum status Plane::write(Event &event)
 {
-	assert(event.get_address().block < size && event.get_address().valid > PLANE && next_page.valid >= BLOCK);
-	enum block_state prev = data[event.get_address().block].get_state();
-	if(event.get_address().block == next_page.block)
+	assert(event.get_address().block < size && event.get_address().valid > PLANE);
+	unsigned int block = event.get_address().block;
+	enum block_state prev = data[block].get_state();
+	enum status status = data[block].write(event);
+
+	if(status == SUCCESS)
+	{
+		if(prev == FREE)
+		{
+			free_blocks--;
+
+			/* the block holding next_page is not one of the free blocks */
+			if(block != next_page.block || next_page.valid < PAGE)
+				remove_free_block(block);
+		}
+
 		/* if all blocks in the plane are full and this function fails,
 		 * the next_page address valid field will be set to PLANE */
-		(void) get_next_page();
-	if(prev == FREE && data[event.get_address().block].get_state() != FREE)
-		free_blocks--;
-	return data[event.get_address().block].write(event);
+		if(block == next_page.block && next_page.valid == PAGE && data[block].get_next_page(next_page) == FAILURE)
+			(void) get_next_page();
+
+		/* a block becomes a cleaning candidate once it is fully written */
+		Address last_page;
+		if(data[block].get_next_page(last_page) == FAILURE)
+			victims.insert(block, data[block].get_pages_valid());
+	}
+	return status;
 }
 
 /* if no errors
  * 	updates last_erase_time if later time
  * 	updates erases_remaining if smaller value
+ * 	puts the block back in the free blocks
  * returns 1 for success, 0 for failure */
 enum status Plane::erase(Event &event)
 {
 	assert(event.get_address().block < size && event.get_address().valid > PLANE);
-	enum status status = data[event.get_address().block]._erase(event);
+	unsigned int block = event.get_address().block;
+	enum block_state prev = data[block].get_state();
+	enum status status = data[block]._erase(event);
 
 	/* update values if no errors */
 	if(status == 1)
 	{
-		update_wear_stats();
-		free_blocks++;
+		update_wear_stats(event.get_address());
+		if(victims.contains(block))
+			victims.remove(block);
+
+		/* the block holding next_page starts over at its first page */
+		if(block == next_page.block && next_page.valid == PAGE)
+			(void) data[block].get_next_page(next_page);
+		else if(prev != FREE)
+			add_free_block(block);
+		if(prev != FREE)
+			free_blocks++;
 
 		/* set next free page if plane was completely full */
 		if(next_page.valid < PAGE)
@@ -151,6 +197,8 @@ enum status Plane::erase(Event &event)
 /* handle everything for a merge operation
  * 	address.block and address_merge.block must be valid
  * 	move event::address valid pages to event::address_merge empty pages
+ * 	a page address limits the merge to that page, which makes a page address
+ * 		pair a copyback of one page through the plane register
  * creates own events for resulting read/write operations
  * supports blocks that have different sizes */
 enum status Plane::_merge(Event &event)
@@ -166,18 +214,30 @@ enum status Plane::_merge(Event &event)
 	/* get and check address validity and size of blocks involved in the merge */
 	const Address &address = event.get_address();
 	const Address &merge_address = event.get_merge_address();
-	assert(address.compare(merge_address) >= BLOCK);
+	assert(address.compare(merge_address) >= PLANE);
 	assert(address.block < size && merge_address.block < size);
 	unsigned int block_size = data[address.block].get_size();
 	unsigned int merge_block_size = data[merge_address.block].get_size();
+	unsigned int first_page = 0;
+	unsigned int first_merge_page = 0;
+	if(address.valid == PAGE)
+	{
+		first_page = address.page;
+		block_size = address.page + 1;
+	}
+	if(merge_address.valid == PAGE)
+	{
+		first_merge_page = merge_address.page;
+		merge_block_size = merge_address.page + 1;
+	}
 
 	/* how many pages must be moved */
-	for(i = 0; i < block_size; i++)
+	for(i = first_page; i < block_size; i++)
 		if(data[address.block].get_state(i) == VALID)
 			merge_count++;
 	
 	/* how many pages are available */
-	for(i = 0; i < merge_block_size; i++)
+	for(i = first_merge_page; i < merge_block_size; i++)
 		if(data[merge_address.block].get_state(i) == EMPTY)
 			merge_avail++;
 
@@ -191,9 +251,9 @@ enum status Plane::_merge(Event &event)
 	/* create event classes to handle read and write events for the merge */
 	Address read(address);
 	Address write(merge_address);
-	read.page = 0;
+	read.page = first_page;
 	read.valid = PAGE;
-	write.page = 0;
+	write.page = first_merge_page;
 	write.valid = PAGE;
 	Event read_event(READ, 0, 1, event.get_start_time());
 	Event write_event(WRITE, 0, 1, event.get_start_time());
@@ -208,12 +268,13 @@ enum status Plane::_merge(Event &event)
 		if(data[read.block].get_state(read.page) == VALID)
 		{
 			/* read from page and set status to invalid */
+			read_event.set_address(read);
 			if(data[read.block].read(read_event) == 0)
 			{
 				fprintf(stderr, "Plane error: %s: Read for merge block %d into %d failed\n", __func__, read.block, write.block);
 				i++;
 			}
-			data[read.block].invalidate_page(read.page);
+			invalidate_page(read);
 
 			/* get time taken for read and plane register write
 			 * read event time will accumulate and be added at end */
@@ -225,8 +286,10 @@ enum status Plane::_merge(Event &event)
 				/* find next page to write to */
 				if(data[write.block].get_state(write.page) == EMPTY)
 				{
-					/* write to page (page::_write() sets status to valid) */
-					if(data[merge_address.block].write(write_event) == 0)
+					/* write to page (Block::write() sets status to valid)
+					 * go through Plane::write() to keep the free block list */
+					write_event.set_address(write);
+					if(this -> write(write_event) == 0)
 					{
 						fprintf(stderr, "Plane error: %s: Write for merge block %d into %d failed\n", __func__, address.block, merge_address.block);
 						i++;
@@ -244,10 +307,6 @@ enum status Plane::_merge(Event &event)
 	total_delay += read_event.get_time_taken() + write_event.get_time_taken();
 	event.incr_time_taken(total_delay);
 
-	/* update next_page for the get_free_page method if we used the page */
-	if(next_page.valid < PAGE)
-		(void) get_next_page();
-
 	if(i == 0)
 		return SUCCESS;
 	else
@@ -289,30 +348,41 @@ unsigned long Plane::get_erases_remaining(const Address &address) const
 		return erases_remaining;
 }
 
-/* Block with the most erases remaining is the least worn */
-void Plane::update_wear_stats(void)
+/* Block with the most erases remaining is the least worn
+ * only the erased block changed, so only its path in the wear index is
+ * replayed */
+void Plane::update_wear_stats(const Address &address)
 {
-	unsigned int i;
-	unsigned int max_index = 0;
-	unsigned long max = data[0].get_erases_remaining();
-	for(i = 1; i < size; i++)
-		if(data[i].get_erases_remaining() > max)
-			max_index = i;
-	least_worn = max_index;
-	erases_remaining = max;
-	last_erase_time = data[max_index].get_last_erase_time();
+	assert(data != NULL && address.block < size);
+	const Block &block = data[address.block];
+	wear.update(address.block, block.get_erases_remaining(), block.get_erases_remaining());
+	erases_remaining = wear.get_max_erases_remaining();
+	if(block.get_last_erase_time() > last_erase_time)
+		last_erase_time = block.get_last_erase_time();
 	return;
 }
 
 /* update given address.block to least worn block */
 void Plane::get_least_worn(Address &address) const
 {
-	assert(least_worn < size);
-	address.block = least_worn;
+	address.block = wear.get_least_worn();
+	address.valid = BLOCK;
+	return;
+}
+
+/* update given address.block to most worn block */
+void Plane::get_most_worn(Address &address) const
+{
+	address.block = wear.get_most_worn();
 	address.valid = BLOCK;
 	return;
 }
 
+const Wear_index &Plane::get_wear_index(void) const
+{
+	return wear;
+}
+
 enum page_state Plane::get_state(const Address &address) const
 {  
 	assert(data != NULL && address.block < size && address.valid >= PLANE);
@@ -329,28 +399,57 @@ void Plane::get_free_page(Address &address) const
 	return;
 }
 
-/* internal method to keep track of the next usable (free or active) page in
- *    this plane
- * method is called by write and erase methods and calls Block::get_next_page()
- *    such that the get_free_page method can run in constant time */
+/* update address to the first page of the least worn free block
+ * the block holding next_page is not one of the free blocks, so writes to
+ * the returned block do not move next_page
+ * error condition will result in (address.valid < PAGE) */
+void Plane::get_free_block(Address &address) const
+{
+	if(free_wear.get_max_erases_remaining() == 0)
+	{
+		address.valid = PLANE;
+		return;
+	}
+	address.block = free_wear.get_least_worn();
+	address.page = 0;
+	address.valid = PAGE;
+	return;
+}
+
+/* internal method to keep track of the next usable (free) page in this plane
+ * method is called by write and erase methods when the block holding
+ *    next_page has no empty pages left and takes the least worn free block
+ *    such that the get_free_page method can run in constant time
+ * this is the dynamic wear leveling of the plane: erased blocks are reused
+ *    in order of wear rather than in the order they were erased */
 enum status Plane::get_next_page(void)
 {
-	unsigned int i;
 	next_page.valid = PLANE;
 
-	for(i = 0; i < size; i++)
-	{
-		if(data[i].get_state() != INACTIVE)
-		{
-			next_page.valid = BLOCK;
-			if(data[i].get_next_page(next_page) == SUCCESS)
-			{
-				next_page.block = i;
-				return SUCCESS;
-			}
-		}
-	}
-	return FAILURE;
+	if(free_wear.get_max_erases_remaining() == 0)
+		return FAILURE;
+	unsigned int block = free_wear.get_least_worn();
+	remove_free_block(block);
+	next_page.block = block;
+	next_page.valid = BLOCK;
+	return data[block].get_next_page(next_page);
+}
+
+/* add a free block to the free blocks at its current wear */
+void Plane::add_free_block(unsigned int block)
+{
+	assert(block < size);
+	unsigned long key = data[block].get_erases_remaining() + 1;
+	free_wear.update(block, key, key);
+	return;
+}
+
+/* take a block out of the free blocks */
+void Plane::remove_free_block(unsigned int block)
+{
+	assert(block < size);
+	free_wear.update(block, 0, 0);
+	return;
 }
 
 /* free_blocks is updated in the write and erase methods */
@@ -365,3 +464,27 @@ unsigned int Plane::get_num_valid(const Address &address) const
 	assert(address.valid >= PLANE);
 	return data[address.block].get_pages_valid();
 }
+
+/* the fully written block with the fewest valid pages
+ * returns its number of valid pages or BLOCK_SIZE + 1 if there is none */
+unsigned int Plane::get_victim(Address &address) const
+{
+	assert(address.valid >= PLANE);
+	if(victims.get_min() == size)
+		return BLOCK_SIZE + 1;
+	address.block = victims.get_min();
+	address.page = 0;
+	address.valid = BLOCK;
+	return victims.get_min_key();
+}
+
+/* mark a page that holds stale data
+ * the block moves to the victim index bucket for its new valid page count */
+void Plane::invalidate_page(const Address &address)
+{
+	assert(address.block < size && address.valid == PAGE);
+	data[address.block].invalidate_page(address.page);
+	if(victims.contains(address.block))
+		victims.update(address.block, data[address.block].get_pages_valid());
+	return;
+}
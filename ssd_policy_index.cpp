@@ -0,0 +1,135 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_policy_index.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Policy_index class
+ *
+ * Index of the cleaning candidates of a cleaning policy, see ssd.h.  Each
+ * bucket is a set of (order, candidate) pairs, so its first candidate is the
+ * one with the lowest order and, among those, the lowest number.  The lowest
+ * non-empty bucket is kept up to date by stepping up to max_key buckets when
+ * it empties.  max_key + 1 is the key of candidates that are not in the
+ * index. */
+
+#include <assert.h>
+#include <stdio.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+Policy_index::Policy_index(unsigned int max_key):
+	max_key(max_key),
+	min_key(max_key + 1),
+	key(),
+	order(),
+	buckets(max_key + 1)
+{
+	return;
+}
+
+Policy_index::~Policy_index(void)
+{
+	return;
+}
+
+/* add a candidate */
+void Policy_index::insert(unsigned long child, unsigned int key, double order)
+{
+	assert(key <= max_key && !contains(child));
+	if(child >= this -> key.size())
+	{
+		this -> key.resize(child + 1, max_key + 1);
+		this -> order.resize(child + 1, 0.0);
+	}
+	link(child, key, order);
+	return;
+}
+
+/* drop a candidate that was cleaned or can no longer be */
+void Policy_index::remove(unsigned long child)
+{
+	assert(contains(child));
+	unlink(child);
+	key[child] = max_key + 1;
+	return;
+}
+
+/* move a candidate to the bucket for its new key and order */
+void Policy_index::update(unsigned long child, unsigned int key, double order)
+{
+	assert(key <= max_key && contains(child));
+	if(this -> key[child] == key && this -> order[child] == order)
+		return;
+	unlink(child);
+	link(child, key, order);
+	return;
+}
+
+bool Policy_index::contains(unsigned long child) const
+{
+	return child < key.size() && key[child] <= max_key;
+}
+
+double Policy_index::get_order(unsigned long child) const
+{
+	assert(contains(child));
+	return order[child];
+}
+
+/* the first candidate of the lowest bucket
+ * returns false if there is no candidate */
+bool Policy_index::get_min(unsigned long &child) const
+{
+	if(min_key > max_key)
+		return false;
+	child = buckets[min_key].begin() -> second;
+	return true;
+}
+
+/* the first candidate of the bucket for key
+ * returns false if the bucket is empty */
+bool Policy_index::get_first(unsigned int key, unsigned long &child) const
+{
+	assert(key <= max_key);
+	if(buckets[key].empty())
+		return false;
+	child = buckets[key].begin() -> second;
+	return true;
+}
+
+void Policy_index::link(unsigned long child, unsigned int key, double order)
+{
+	this -> key[child] = key;
+	this -> order[child] = order;
+	(void) buckets[key].insert(std::make_pair(order, child));
+	if(key < min_key)
+		min_key = key;
+	return;
+}
+
+void Policy_index::unlink(unsigned long child)
+{
+	unsigned int key = this -> key[child];
+	(void) buckets[key].erase(std::make_pair(order[child], child));
+
+	/* step up to the next non-empty bucket */
+	if(key == min_key)
+		while(min_key <= max_key && buckets[min_key].empty())
+			min_key++;
+	return;
+}
@@ -0,0 +1,73 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_ppa.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Ppa class
+ *
+ * Physical page address packed into 64 bits with the field layout of the
+ * loaded geometry.  Packing and unpacking are done by the global GEOMETRY,
+ * so Ppas must only be created after load_config(). */
+
+#include <assert.h>
+#include <stdio.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+/* packed form of the default Address (valid == NONE) */
+Ppa::Ppa(void):
+	value(0)
+{
+	return;
+}
+
+Ppa::Ppa(const Address &address):
+	value(GEOMETRY.pack(address))
+{
+	return;
+}
+
+Address Ppa::get_address(void) const
+{
+	Address address;
+	GEOMETRY.unpack(value, address);
+	return address;
+}
+
+void Ppa::get_address(Address &address) const
+{
+	GEOMETRY.unpack(value, address);
+	return;
+}
+
+enum address_valid Ppa::get_valid(void) const
+{
+	Address address;
+	GEOMETRY.unpack(value, address);
+	return address.valid;
+}
+
+/* mix the packed bits so that addresses that differ only in high fields
+ * spread over hash buckets (splitmix64 finalizer) */
+unsigned long Ppa::hash(void) const
+{
+	unsigned long hash = value;
+	hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9UL;
+	hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebUL;
+	return hash ^ (hash >> 31);
+}
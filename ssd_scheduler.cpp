@@ -0,0 +1,104 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_scheduler.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Scheduler class
+ *
+ * Pending events of the discrete event simulation.  The events are kept in a
+ * binary heap in a vector, so scheduling an event and taking the next one
+ * are O(log n) and do not allocate once the vector has grown to the largest
+ * number of pending events.  Events at the same time are taken in the order
+ * they were scheduled, which keeps runs deterministic.  The clock only moves
+ * forward: it is the time of the last event taken, and an event cannot be
+ * scheduled before it. */
+
+#include <algorithm>
+#include <new>
+#include <assert.h>
+#include <float.h>
+#include <stdio.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+/* heap order: the root is the earliest event, ties go to the one scheduled
+ * first */
+static bool later(const Sched_event &a, const Sched_event &b)
+{
+	if(a.time != b.time)
+		return a.time > b.time;
+	return a.order > b.order;
+}
+
+Scheduler::Scheduler(void):
+	heap(),
+	now(0.0),
+	order(0)
+{
+	return;
+}
+
+Scheduler::~Scheduler(void)
+{
+	return;
+}
+
+/* an event in the past happens now */
+void Scheduler::schedule(double time, enum sched_type type, unsigned long tag)
+{
+	Sched_event event;
+	event.time = time > now ? time : now;
+	event.order = order++;
+	event.type = type;
+	event.tag = tag;
+	heap.push_back(event);
+	std::push_heap(heap.begin(), heap.end(), later);
+	return;
+}
+
+/* take the earliest event if it is not after until and move the clock to it
+ * returns false if there is no such event */
+bool Scheduler::next(Sched_event &event, double until)
+{
+	if(heap.empty() || heap.front().time > until)
+		return false;
+	std::pop_heap(heap.begin(), heap.end(), later);
+	event = heap.back();
+	heap.pop_back();
+	now = event.time;
+	return true;
+}
+
+bool Scheduler::is_empty(void) const
+{
+	return heap.empty();
+}
+
+/* time of the last event taken */
+double Scheduler::get_time(void) const
+{
+	return now;
+}
+
+/* time of the earliest pending event, DBL_MAX if there is none */
+double Scheduler::get_next_time(void) const
+{
+	if(heap.empty())
+		return DBL_MAX;
+	return heap.front().time;
+}
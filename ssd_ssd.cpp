@@ -22,11 +22,22 @@
  *
  * The SSD is the single main object that will be created to simulate a real
  * SSD.  Creating a SSD causes all other objects in the SSD to be created.  The
- * event_arrive method is where events will arrive from DiskSim. */
-
+ * event_arrive method is where events will arrive from DiskSim.
+ *
+ * Requests can also be submitted to run as a discrete event simulation, see
+ * submit.  The scheduler holds the arrivals and completions of host requests
+ * and the steps of idle cleaning in time order.  A request is serviced when
+ * its arrival is taken: its flash operations and bus transfers are placed on
+ * the die and channel timelines, where they wait for operations of requests
+ * still in flight, and its completion is scheduled for when the last of them
+ * finishes.  Completions are therefore returned in the order requests finish,
+ * which need not be the order they were submitted in. */
+
+#include <algorithm>
 #include <cmath>
 #include <new>
 #include <assert.h>
+#include <float.h>
 #include <stdio.h>
 #include "ssd.h"
 
@@ -40,7 +51,7 @@ Ssd::Ssd(FILE *log_file, unsigned int ssd_size):
 	size(ssd_size), 
 	controller(*this, log_file), 
 	ram(RAM_READ_DELAY, RAM_WRITE_DELAY), 
-	bus(size, BUS_CTRL_DELAY, BUS_DATA_DELAY, BUS_TABLE_SIZE, BUS_MAX_CONNECT), 
+	bus(size, BUS_CTRL_DELAY, BUS_DATA_DELAY, BUS_MAX_CONNECT), 
 
 	/* use a const pointer (Package * const data) to use as an array
 	 * but like a reference, we cannot reseat the pointer */
@@ -51,13 +62,29 @@ Ssd::Ssd(FILE *log_file, unsigned int ssd_size):
 	 * this is the cheap implementation but can change to pass through classes */
 	erases_remaining(BLOCK_ERASES), 
 
-	/* assume all Planes are same so first one can start as least worn */
-	least_worn(0), 
+	/* assume all Packages are same so first one can start as least worn */
+	wear(ssd_size, BLOCK_ERASES), 
 
 	/* assume hardware created at time 0 and had an implied free erasure */
 	last_erase_time(0.0),
   total_erases_performed(0),
-  total_writes_observed(0)
+  total_merges_performed(0),
+  total_writes_observed(0),
+  total_host_writes(0),
+  last_completion_time(0.0),
+  idle_gc_time(0.0),
+  hidden_gc_time(0.0),
+  idle_gc_until(0.0),
+  idle_gc_blocks(0),
+  last_bus_wait_time(0.0),
+  total_bus_wait_time(0.0),
+  scheduler(),
+  requests(),
+  completions(),
+  next_request_id(0),
+  num_arrived(0),
+  num_active(0),
+  max_num_erases(0)
 {
 	unsigned int i;
 
@@ -104,6 +131,11 @@ double Ssd::event_arrive(enum event_type type, unsigned long logical_address, un
 	assert(start_time >= 0.0);
 	assert((long long int) logical_address < (long long int) SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
 
+	/* clean in the background if the drive has been idle long enough */
+	double gc_delay = 0.0;
+	if(GC_IDLE_THRESHOLD > 0.0 && start_time - last_completion_time >= GC_IDLE_THRESHOLD)
+		gc_delay = collect_idle(start_time);
+
 	/* allocate the event and address dynamically so that the allocator can
 	 * handle efficiency issues for us */
 	Event *event = NULL;
@@ -114,16 +146,12 @@ double Ssd::event_arrive(enum event_type type, unsigned long logical_address, un
 		exit(MEM_ERR);
 	}
 
-	/* REAL SSD ONLY */
-  *status = controller.event_arrive(*event);
-  address = event->get_address();
-	if(*status != SUCCESS)
-	{
-		fprintf(log_file, "Ssd error: %s: request failed:\n", __func__);
-		event -> print(log_file);
-	}
+	/* the request waits for background cleaning that ran past its arrival */
+	(void) event -> incr_time_taken(gc_delay);
 
-  //event -> print(log_file);
+	/* REAL SSD ONLY */
+	*status = service(*event);
+	address = event -> get_address();
 
 	/* use start_time as a temporary for returning time taken to service event */
 	start_time = event -> get_time_taken();
@@ -131,18 +159,262 @@ double Ssd::event_arrive(enum event_type type, unsigned long logical_address, un
 	return start_time;
 }
 
+/* pass a host request to the controller and record its latency, bus wait
+ * and completion */
+enum status Ssd::service(Event &event)
+{
+	/* requests arrive in time order, so no transfer can start before this
+	 * one arrived */
+	bus.unlock(event.get_start_time());
+
+	/* background cleaning that runs past the arrival was not hidden */
+	if(idle_gc_until > event.get_start_time())
+		hidden_gc_time -= idle_gc_until - event.get_start_time();
+	idle_gc_until = 0.0;
+	enum status status = controller.event_arrive(event);
+	if(status != SUCCESS)
+	{
+		fprintf(log_file, "Ssd error: %s: request failed:\n", __func__);
+		event.print(log_file);
+	}
+	else
+	{
+		if(event.get_event_type() == WRITE)
+			total_host_writes += event.get_size();
+		(event.get_event_type() == READ ? read_latencies : write_latencies).push_back(event.get_time_taken());
+	}
+	last_bus_wait_time = event.get_bus_wait_time();
+	total_bus_wait_time += last_bus_wait_time;
+
+	if(event.get_start_time() + event.get_time_taken() > last_completion_time)
+		last_completion_time = event.get_start_time() + event.get_time_taken();
+	return status;
+}
+
+/* queue a host request to arrive at arrive_time
+ * nothing is serviced until the simulation is run
+ * returns the id of the request, which its completion carries */
+unsigned long Ssd::submit(enum event_type type, unsigned long logical_address, unsigned int size, double arrive_time)
+{
+	assert(arrive_time >= scheduler.get_time());
+	assert((long long int) logical_address < (long long int) SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
+
+	Request &request = requests[next_request_id];
+	request.id = next_request_id;
+	request.type = type;
+	request.logical_address = logical_address;
+	request.size = size;
+	request.arrive_time = arrive_time;
+	request.finish_time = arrive_time;
+	request.bus_wait_time = 0.0;
+	request.status = FAILURE;
+	scheduler.schedule(arrive_time, ARRIVAL, next_request_id);
+	return next_request_id++;
+}
+
+/* take the scheduled events up to and including time until */
+void Ssd::run(double until)
+{
+	Sched_event event;
+	while(scheduler.next(event, until))
+	{
+		switch(event.type)
+		{
+			case ARRIVAL: arrive(event.tag); break;
+			case COMPLETION: complete(event.tag); break;
+			case IDLE_GC: collect_step(event.tag); break;
+		}
+	}
+	return;
+}
+
+/* run until nothing is left to do */
+void Ssd::run(void)
+{
+	run(DBL_MAX);
+	return;
+}
+
+/* take the earliest completion not yet taken
+ * returns false if no request has completed since the last call */
+bool Ssd::get_completion(Request &request)
+{
+	if(completions.empty())
+		return false;
+	request = completions.front();
+	completions.pop_front();
+	return true;
+}
+
+/* the simulation clock */
+double Ssd::get_time(void) const
+{
+	return scheduler.get_time();
+}
+
+/* time of the next scheduled event, DBL_MAX if there is none */
+double Ssd::get_next_time(void) const
+{
+	return scheduler.get_next_time();
+}
+
+void Ssd::arrive(unsigned long id)
+{
+	std::unordered_map<unsigned long, Request>::iterator it = requests.find(id);
+	assert(it != requests.end());
+	Request &request = it -> second;
+	num_arrived++;
+	num_active++;
+
+	Event event(request.type, request.logical_address, request.size, request.arrive_time);
+	request.status = service(event);
+	request.address = event.get_address();
+	request.bus_wait_time = event.get_bus_wait_time();
+	request.finish_time = request.arrive_time + event.get_time_taken();
+	scheduler.schedule(request.finish_time, COMPLETION, id);
+	return;
+}
+
+/* once the drive has no request left, it starts cleaning when it has been
+ * idle for GC_IDLE_THRESHOLD
+ * the step is tagged with the number of arrivals so that it can tell whether
+ * a request came in meanwhile */
+void Ssd::complete(unsigned long id)
+{
+	std::unordered_map<unsigned long, Request>::iterator it = requests.find(id);
+	assert(it != requests.end() && num_active > 0);
+	completions.push_back(it -> second);
+	requests.erase(it);
+	if(--num_active == 0 && GC_IDLE_THRESHOLD > 0.0)
+		scheduler.schedule(scheduler.get_time() + GC_IDLE_THRESHOLD, IDLE_GC, num_arrived);
+	return;
+}
+
+/* clean one block, or one merge, and schedule the next step for when it is
+ * done
+ * the step is dropped if a request has arrived since the drive went idle,
+ * cleaning resumes when the drive goes idle again
+ * requests that arrive during a step wait for its operations on the dies */
+void Ssd::collect_step(unsigned long tag)
+{
+	if(tag != num_arrived || num_active > 0)
+		return;
+	Event event(ERASE, 0, 1, scheduler.get_time());
+	unsigned int cleaned = controller.collect_idle_step(event);
+	account_idle_gc(event, cleaned);
+	if(cleaned > 0)
+		scheduler.schedule(scheduler.get_time() + event.get_time_taken(), IDLE_GC, tag);
+	return;
+}
+
 unsigned long Ssd::get_total_writes_observed()
 {
   return total_writes_observed;
 }
 
+/* pages written by the host */
+unsigned long Ssd::get_total_host_writes()
+{
+  return total_host_writes;
+}
+
+/* pages written to flash, including garbage collection and mapping pages,
+ * per page written by the host */
+double Ssd::get_write_amplification()
+{
+  if(total_host_writes == 0)
+    return 0.0;
+  return (double) total_writes_observed / total_host_writes;
+}
+
+/* number of times the block of the address was erased */
+unsigned long Ssd::get_block_erase_count(Address address)
+{
+  address.valid = BLOCK;
+  return BLOCK_ERASES - get_erases_remaining(address);
+}
+
+/* time spent cleaning in the background */
+double Ssd::get_idle_gc_time()
+{
+  return idle_gc_time;
+}
+
+/* part of the background cleaning time that fell in idle periods, the rest
+ * delayed the requests that arrived during it */
+double Ssd::get_hidden_gc_time()
+{
+  return hidden_gc_time;
+}
+
+/* number of blocks cleaned in the background */
+unsigned long Ssd::get_idle_gc_blocks()
+{
+  return idle_gc_blocks;
+}
+
+/* time the last request spent waiting for bus channels held by other
+ * transfers, part of the time event_arrive returned for it */
+double Ssd::get_last_bus_wait_time()
+{
+  return last_bus_wait_time;
+}
+
+/* time all requests spent waiting for bus channels */
+double Ssd::get_total_bus_wait_time()
+{
+  return total_bus_wait_time;
+}
+
+/* latency that the given percentage of successful reads or writes do not
+ * exceed, 0 if there were none */
+double Ssd::get_latency_percentile(enum event_type type, double percentile)
+{
+  std::vector<double> latencies(type == READ ? read_latencies : write_latencies);
+  if(latencies.empty())
+    return 0.0;
+  unsigned long rank = (unsigned long) ceil(percentile / 100 * latencies.size());
+  if(rank > 0)
+    rank--;
+  if(rank >= latencies.size())
+    rank = latencies.size() - 1;
+  std::nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+  return latencies[rank];
+}
+
+/* print the number of reads and writes whose latencies fall in each power of
+ * two range, followed by the tail percentiles and the total bus wait */
+void Ssd::print_latency_histogram(FILE *stream)
+{
+  const enum event_type types[] = {READ, WRITE};
+  for(unsigned int i = 0; i < 2; i++)
+  {
+    const std::vector<double> &latencies = types[i] == READ ? read_latencies : write_latencies;
+    std::map<int, unsigned long> buckets;
+    for(unsigned long j = 0; j < latencies.size(); j++)
+    {
+      int exponent = 0;
+      (void) frexp(latencies[j], &exponent);
+      buckets[exponent]++;
+    }
+
+    fprintf(stream, "%s latency histogram (%lu requests):\n", types[i] == READ ? "Read" : "Write", latencies.size());
+    for(std::map<int, unsigned long>::iterator it = buckets.begin(); it != buckets.end(); it++)
+      fprintf(stream, "  [%g, %g): %lu\n", ldexp(0.5, it -> first), ldexp(1.0, it -> first), it -> second);
+    fprintf(stream, "  p50 %g  p99 %g  p99.9 %g  max %g\n",
+        get_latency_percentile(types[i], 50), get_latency_percentile(types[i], 99),
+        get_latency_percentile(types[i], 99.9), get_latency_percentile(types[i], 100));
+  }
+  fprintf(stream, "Bus wait: %g\n", total_bus_wait_time);
+}
+
 unsigned long Ssd::get_pages_per_block()
 {
   return BLOCK_SIZE;
 }
 
 /* read write erase and merge should only pass on the event
- * 	the Controller should lock the bus channels
+ * 	the Controller locks the bus channels
  * technically the Package is conceptual, but we keep track of statistics
  * 	and addresses with Packages, so send Events through Package but do not 
  * 	have Package do anything but update its statistics and pass on to Die */
@@ -167,9 +439,8 @@ enum status Ssd::erase(Event &event)
 	/* update values if no errors */
 	if (status == SUCCESS) {
 		update_wear_stats(event.get_address());
-    if(get_erases_remaining(event.get_address()) < (BLOCK_ERASES-max_num_erases)) {
-      max_num_erases = (BLOCK_ERASES - get_erases_remaining(event.get_address()));
-    }
+    /* the most worn block is at the root of the wear index */
+    max_num_erases = BLOCK_ERASES - wear.get_min_erases_remaining();
   }
 	return status;
 }
@@ -177,6 +448,10 @@ enum status Ssd::erase(Event &event)
 enum status Ssd::merge(Event &event)
 {
 	assert(data != NULL && event.get_address().package < size && event.get_address().valid >= PACKAGE);
+	assert(event.get_address().compare(event.get_merge_address()) >= DIE);
+	if(event.get_address().valid == PAGE)
+		total_writes_observed++;
+  total_merges_performed++;
 	return data[event.get_address().package].merge(event);
 }
 
@@ -190,27 +465,36 @@ unsigned long Ssd::get_erases_remaining(const Address &address) const
 	else return erases_remaining;
 }
 
+/* Package with the most erases remaining is the least worn
+ * only the package holding the erased block changed, so only its path in the
+ * wear index is replayed */
 void Ssd::update_wear_stats(const Address &address)
 {
-	assert(data != NULL);
-	unsigned int i;
-	unsigned int max_index = 0;
-	unsigned long max = data[0].get_erases_remaining(address);
-	for(i = 1; i < size; i++)
-		if(data[i].get_erases_remaining(address) > max)
-			max_index = i;
-	least_worn = max_index;
-	erases_remaining = max;
-	last_erase_time = data[max_index].get_last_erase_time(address);
+	assert(data != NULL && address.package < size);
+	wear.update(address.package, data[address.package].get_wear_index());
+	erases_remaining = wear.get_max_erases_remaining();
+	if(data[address.package].get_last_erase_time(address) > last_erase_time)
+		last_erase_time = data[address.package].get_last_erase_time(address);
 	return;
 }
 
+/* update given address -> package to least worn package */
 void Ssd::get_least_worn(Address &address) const
 {
-	assert(data != NULL && least_worn < size);
-	address.package = least_worn;
+	assert(data != NULL);
+	address.package = wear.get_least_worn();
+	address.valid = PACKAGE;
+	data[address.package].get_least_worn(address);
+	return;
+}
+
+/* update given address -> package to most worn package */
+void Ssd::get_most_worn(Address &address) const
+{
+	assert(data != NULL);
+	address.package = wear.get_most_worn();
 	address.valid = PACKAGE;
-	data[least_worn].get_least_worn(address);
+	data[address.package].get_most_worn(address);
 	return;
 }
 
@@ -237,6 +521,13 @@ void Ssd::get_free_page(Address &address) const
 	return;
 }
 
+void Ssd::get_free_block(Address &address) const
+{
+	assert(address.package < size && address.valid >= PACKAGE);
+	data[address.package].get_free_block(address);
+	return;
+}
+
 unsigned int Ssd::get_num_free(const Address &address) const
 {
 	assert(address.package < size && address.valid >= PACKAGE);
@@ -249,14 +540,76 @@ unsigned int Ssd::get_num_valid(const Address &address) const
 	return data[address.package].get_num_valid(address);
 }
 
+/* the fully written block with the fewest valid pages of any package
+ * returns its number of valid pages or BLOCK_SIZE + 1 if there is none */
+unsigned int Ssd::get_victim(Address &address) const
+{
+	unsigned int i;
+	unsigned int min_valid = BLOCK_SIZE + 1;
+	Address victim(address);
+	for(i = 0; i < size; i++)
+	{
+		address.package = i;
+		address.valid = PACKAGE;
+		unsigned int valid = data[i].get_victim(address);
+		if(valid < min_valid)
+		{
+			min_valid = valid;
+			victim = address;
+		}
+	}
+	address = victim;
+	return min_valid;
+}
+
+void Ssd::invalidate_page(const Address &address)
+{
+	assert(address.package < size && address.valid >= PACKAGE);
+	data[address.package].invalidate_page(address);
+	return;
+}
+
+/* clean in the background from the completion of the last request until
+ * start_time, when the next request arrives
+ * cleaning a block is not interrupted, so it can run past start_time
+ * returns how long the next request has to wait for it */
+double Ssd::collect_idle(double start_time)
+{
+	double idle_time = start_time - last_completion_time;
+	Event event(ERASE, 0, 1, last_completion_time);
+	account_idle_gc(event, controller.collect_idle(event, idle_time));
+	if(event.get_time_taken() <= idle_time)
+		return 0.0;
+	return event.get_time_taken() - idle_time;
+}
+
+/* count background cleaning in the idle cleaning statistics
+ * it is counted as hidden until the next request arrives, see Ssd::service(),
+ * whether the request came through event_arrive or the event queue */
+void Ssd::account_idle_gc(const Event &event, unsigned int cleaned)
+{
+	idle_gc_blocks += cleaned;
+	idle_gc_time += event.get_time_taken();
+	hidden_gc_time += event.get_time_taken();
+	if(event.get_start_time() + event.get_time_taken() > idle_gc_until)
+		idle_gc_until = event.get_start_time() + event.get_time_taken();
+	return;
+}
+
 unsigned long Ssd::get_total_erases_performed()
 {
   return total_erases_performed;
 }
 
+/* merges done inside a die, page copybacks included */
+unsigned long Ssd::get_total_merges_performed()
+{
+  return total_merges_performed;
+}
+
 void Ssd::write_ref_map(unsigned long lba, Address pba)
 {
-  ref_map[lba] = pba;
+  ref_map[lba] = Ppa(pba);
 }
 
 unsigned long Ssd::get_max_num_erases()
@@ -266,15 +619,12 @@ unsigned long Ssd::get_max_num_erases()
 
 bool Ssd::is_valid(unsigned long lba, Address validate_with)
 {
-  std::map<unsigned long, Address>::iterator validate_it = ref_map.find(lba);
-  Address addr;
-  if(validate_it != ref_map.end()) {
-    addr = validate_it->second;
-  } else {
+  std::map<unsigned long, Ppa>::iterator validate_it = ref_map.find(lba);
+  if(validate_it == ref_map.end()) {
     return false;
   }
 
-  if(addr == validate_with) {
+  if(validate_it->second == Ppa(validate_with)) {
     return true;
   }
   return false;
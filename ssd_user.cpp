@@ -26,6 +26,8 @@
  * rely on the Garbage_collector and Wear_leveler classes for modularity and
  * simplicity. */
 
+#include <algorithm>
+#include <iterator>
 #include <new>
 #include <assert.h>
 #include <stdio.h>
@@ -56,19 +58,24 @@ void Ftl::init_ftl_user()
   num_blocks_log_reservation = (OVERPROVISIONING/100) * total_num_blocks_raw;
   /* get the number of data blocks available */
   num_blocks_available = total_num_blocks_raw - num_blocks_log_reservation;
-  /* get the cleaning block logical addr */
-  cleaning_block_logical_addr = (total_num_blocks_raw - 1) * BLOCK_SIZE;
-  unsigned int package_num_mod,dies_num_mod,plane_num_mod;
-  cleaning_package_num = GET_DIVIDE_NUM(cleaning_block_logical_addr,PACKAGE_SIZE * DIE_SIZE * \
-                               PLANE_SIZE * BLOCK_SIZE);
-  package_num_mod = GET_MOD_NUM(cleaning_block_logical_addr,PACKAGE_SIZE * DIE_SIZE * \
-                                PLANE_SIZE * BLOCK_SIZE);
-  cleaning_dies_num = GET_DIVIDE_NUM(package_num_mod,DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
-  dies_num_mod = GET_MOD_NUM(package_num_mod,DIE_SIZE * PLANE_SIZE * \
-                             BLOCK_SIZE);
-  cleaning_plane_num = GET_DIVIDE_NUM(dies_num_mod,PLANE_SIZE * BLOCK_SIZE);
-  plane_num_mod = GET_MOD_NUM(dies_num_mod,PLANE_SIZE * BLOCK_SIZE);
-  cleaning_block_num = GET_DIVIDE_NUM(plane_num_mod,BLOCK_SIZE);
+  assert(CLEANING_BLOCKS > 0 && CLEANING_BLOCKS < num_blocks_log_reservation);
+
+  /* The cleaning blocks are taken from the end of each die in turn,
+   * starting with the last die, so that full merges can gather pages on the
+   * die they come from. With one cleaning block it is the last raw block.
+   */
+  unsigned long num_dies = SSD_SIZE * PACKAGE_SIZE;
+  unsigned long die_blocks = DIE_SIZE * PLANE_SIZE;
+  std::vector<bool> is_cleaning_block(total_num_blocks_raw, false);
+  for(unsigned int i = 0; i < CLEANING_BLOCKS; i++)
+  {
+    unsigned long block = (num_dies - i % num_dies) * die_blocks - 1 - i / num_dies;
+    Address address;
+    GEOMETRY.decompose(block * BLOCK_SIZE, address);
+    address.valid = BLOCK;
+    is_cleaning_block[block] = true;
+    cleaning_blocks.push_back(Ppa(address));
+  }
 
 
   /* Initialize a bool array which stores the page states for the SSD.
@@ -82,6 +89,51 @@ void Ftl::init_ftl_user()
 
   /* Initialize the bool array with all 0's to indicate all pages are empty */
   std::fill_n(page_status,total_num_blocks_raw * BLOCK_SIZE,0);
+
+  /* Each logical block starts out in the next physical block that is not a
+   * cleaning block. Merges move it to another block.
+   */
+  data_block_map = new Ppa[num_blocks_available];
+  block_owner = new unsigned int[total_num_blocks_raw];
+  std::fill_n(block_owner, total_num_blocks_raw, num_blocks_available);
+  unsigned long block = 0;
+  for(unsigned long logical_block = 0; logical_block < num_blocks_available;
+      logical_block++, block++)
+  {
+    while(is_cleaning_block[block])
+      block++;
+    Address address;
+    GEOMETRY.decompose(block * BLOCK_SIZE, address);
+    address.valid = BLOCK;
+    data_block_map[logical_block] = Ppa(address);
+    block_owner[block] = logical_block;
+  }
+
+  /* Directory of the log blocks mapped to data blocks, indexed by logical
+   * block number. NULL if no log block is mapped.
+   */
+  log_block_map = new LOG_BLOCK*[num_blocks_available];
+  std::fill_n(log_block_map,num_blocks_available,(LOG_BLOCK*) NULL);
+  log_block_clock = 0;
+
+  /* All the other blocks start in the free pool of log blocks, none of them
+   * worn yet. FAST shares them between the sequential log block and the
+   * random log blocks.
+   */
+  for(; block < total_num_blocks_raw; block++)
+  {
+    if(is_cleaning_block[block])
+      continue;
+    Address address;
+    GEOMETRY.decompose(block * BLOCK_SIZE, address);
+    address.valid = BLOCK;
+    log_blocks.push_back(create_log_block(address));
+    free_log_blocks.insert(std::make_pair(BLOCK_ERASES, log_blocks.back()));
+  }
+
+  /* No page has a copy in the log blocks yet */
+  if(FTL_IMPLEMENTATION == FAST)
+    log_page_map = new Ppa[num_blocks_available * BLOCK_SIZE];
 }
 
 /** @brief Convert LBA to PBA.
@@ -108,6 +160,13 @@ enum status Ftl::translate( Event &event ){
    * directly.
    */
 
+  /* The page-mapped FTL does its own translation */
+  if(page_ftl != NULL)
+    return page_ftl -> translate(event);
+
+  /* Take a step of incremental cleaning */
+  garbage.collect_step(event);
+
   /* Result of the read/write SUCCESS or FAILURE */
   enum status result;
 
@@ -152,42 +211,35 @@ enum status Ftl::translate( Event &event ){
  */
 enum status Ftl::write_event(Event &event,Address* addr_allocate)
 {
+  if(FTL_IMPLEMENTATION == FAST)
+    return fast_write_event(event,addr_allocate);
+
   /* Get the LBA */
   unsigned logical_address = event.get_logical_address();
 
-  /* Get the package number, die number, plane number, block number and 
-   * page number from the LBA.
-   */
-  unsigned int package_num,dies_num,plane_num,block_num,page_num;
-  unsigned int package_num_mod,dies_num_mod,plane_num_mod;
-  package_num = GET_DIVIDE_NUM(logical_address,PACKAGE_SIZE * DIE_SIZE * \
-                               PLANE_SIZE * BLOCK_SIZE);
-  package_num_mod = GET_MOD_NUM(logical_address,PACKAGE_SIZE * DIE_SIZE * \
-                                PLANE_SIZE * BLOCK_SIZE);
-  dies_num = GET_DIVIDE_NUM(package_num_mod,DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
-  dies_num_mod = GET_MOD_NUM(package_num_mod,DIE_SIZE * PLANE_SIZE * \
-                             BLOCK_SIZE);
-  plane_num = GET_DIVIDE_NUM(dies_num_mod,PLANE_SIZE * BLOCK_SIZE);
-  plane_num_mod = GET_MOD_NUM(dies_num_mod,PLANE_SIZE * BLOCK_SIZE);
-  block_num = GET_DIVIDE_NUM(plane_num_mod,BLOCK_SIZE);
-  page_num = GET_MOD_NUM(package_num_mod,BLOCK_SIZE);
-
-  package_number = package_num;
-  dies_number = dies_num;
-  plane_number = plane_num;
-  block_number = block_num;
-
   /* Return with a failure status if the LBA maps to a location which falls
    * into the overprovisioned space.
    */
   if(logical_address >= (num_blocks_available * BLOCK_SIZE))
       return FAILURE;
 
+  /* Get the physical address of the page in the data block from the LBA.
+   * It is replaced by a log block page below if the page was written before.
+   */
+  Address address;
+  get_data_page(logical_address, address);
+  unsigned int page_num = address.page;
+
+  Address block_address = address;
+  block_address.page = 0;
+  block_address.valid = BLOCK;
+  data_block = Ppa(block_address);
+
     /* Page is not empty, that is, it was written before */
     if(page_status[logical_address] == 1)
     {
 
-      int logical_block_number = logical_address/BLOCK_SIZE;
+      int logical_block_number = GEOMETRY.get_block(logical_address);
       if(check_log_block_mapped_data_block(logical_block_number))
       {
 
@@ -197,29 +249,23 @@ enum status Ftl::write_event(Event &event,Address* addr_allocate)
         /* No empty pages left in the log block. Return with a failure sttaus. */
         {
 
-          garbage.collect(event,FIFO);
-          LOG_BLOCK* log_block = log_block_map.at(logical_block_number);
-          /* fill all the page entries with -1 */
-          std::fill_n(log_block->page_entries,BLOCK_SIZE, -1);
+          if(garbage.collect(event,SELECTED_GC_POLICY) == FAILURE)
+            return FAILURE;
+          /* The merge leaves the log block erased */
+          LOG_BLOCK* log_block = log_block_map[logical_block_number];
+          invalidate_latest_page(logical_address);
           /* Map the lba to the first page of the log block */
-          log_block-> page_entries[0] = page_num;
-          package_num = log_block -> package_num;
-          dies_num = log_block -> die_num;
-          plane_num = log_block -> plane_num;
-          block_num = log_block -> block_num;
-          page_num = 0; 
+          log_block -> block.get_address(address);
+          address.page = append_log_block(log_block, page_num, page_num);
         }
 
         else
         {
           /* There is an empty page in the block */
-          LOG_BLOCK* log_block = log_block_map.at(logical_block_number);
-          log_block -> page_entries[page_index] = page_num;
-          package_num = log_block -> package_num;
-          dies_num = log_block -> die_num;
-          plane_num = log_block -> plane_num;
-          block_num = log_block -> block_num;
-          page_num = page_index; 
+          LOG_BLOCK* log_block = log_block_map[logical_block_number];
+          invalidate_latest_page(logical_address);
+          log_block -> block.get_address(address);
+          address.page = append_log_block(log_block, page_num, page_num);
         }
 
       }
@@ -227,61 +273,47 @@ enum status Ftl::write_event(Event &event,Address* addr_allocate)
       /* Log-reservation block not mapped to data block */
       else
       {
-        /* if size of the map is equal to the numbe of overprovisioned blocks
-         * return with a failure.
+        /* if no unmapped log-reservation blocks are left, the garbage
+         * collector merges a victim data block to free its log block.
          */
-        if((num_blocks_available + log_block_map.size()) == (total_num_blocks_raw - 1))
-        {
-          /* No unmapped log-reservation blocks left */
+        if(free_log_blocks.empty() &&
+           garbage.collect(event,SELECTED_GC_POLICY) == FAILURE)
           return FAILURE;
-        }
 
-        /* There are additional log-reservations blocks left. Get the package 
-         * number, die number, plane number, block number and page number of 
-         * the log-blockfrom the LBA.
-         */
-        unsigned long log_block_logical_addr = ((num_blocks_available) + \
-                                                 log_block_map.size()) *  \
-                                                 BLOCK_SIZE;
-        package_num = GET_DIVIDE_NUM(log_block_logical_addr,PACKAGE_SIZE * \
-                                     DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
-        package_num_mod = GET_MOD_NUM(log_block_logical_addr,PACKAGE_SIZE * \
-                                      DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
-        dies_num = GET_DIVIDE_NUM(package_num_mod,DIE_SIZE * PLANE_SIZE * \
-                                  BLOCK_SIZE);
-        dies_num_mod = GET_MOD_NUM(package_num_mod,DIE_SIZE * PLANE_SIZE * \
-                                   BLOCK_SIZE);
-        plane_num = GET_DIVIDE_NUM(dies_num_mod,PLANE_SIZE * BLOCK_SIZE);
-        plane_num_mod = GET_MOD_NUM(dies_num_mod,PLANE_SIZE * BLOCK_SIZE);
-        block_num = GET_DIVIDE_NUM(plane_num_mod,BLOCK_SIZE);
-        page_num = GET_MOD_NUM(package_num_mod,BLOCK_SIZE);
-
-        /* Pack the struct so that it can be inserted into the map */
-        LOG_BLOCK* log_block = new LOG_BLOCK;
-        log_block -> package_num = package_num;
-        log_block -> die_num = dies_num;
-        log_block -> plane_num = plane_num;
-        log_block -> block_num = block_num;
-        log_block -> page_entries = new int[BLOCK_SIZE];
-        /* Initially, fill all the page entries with -1 */
-        std::fill_n(log_block->page_entries,BLOCK_SIZE, -1);
+        LOG_BLOCK* log_block = wear.get_free_log_block();
+        /* Store the log block in the directory at the data block number */
+        log_block -> logical_block = logical_block_number;
+        log_block -> mapped_time = ++log_block_clock;
+        log_block_map[logical_block_number] = log_block;
+        garbage.map_log_block(log_block);
+        invalidate_latest_page(logical_address);
         /* Map the lba to the first page of the log block */
-        log_block-> page_entries[0] = page_num;
-        /* Store the key in the map as the data block number */
-        log_block_map[logical_address/BLOCK_SIZE] = log_block;
+        log_block -> block.get_address(address);
+        address.page = append_log_block(log_block, page_num, page_num);
       }
 
     }
 
     else
+    {
       /* Page was empty before this, now it will be written, so make the
        * corresposding index in page_status as 1.
        */
       page_status[logical_address] = 1;
 
-    /* Pack the new address to which the lba will be mapped */
-    *addr_allocate = new Address(package_num,dies_num,plane_num,block_num,
-                                 page_num,PAGE); 
+      /* A merge of the data block has one more page to copy */
+      LOG_BLOCK* log_block = log_block_map[GEOMETRY.get_block(logical_address)];
+      if(log_block != NULL)
+      {
+        log_block -> num_written++;
+        log_block -> merge_cost++;
+        garbage.index_log_block(log_block);
+      }
+    }
+
+    /* Return the new address to which the lba will be mapped */
+    address.valid = PAGE;
+    *addr_allocate = address;
     return SUCCESS;
 }
 
@@ -290,7 +322,7 @@ enum status Ftl::write_event(Event &event,Address* addr_allocate)
  *  Converts an LBA to a PBA. It first checks if the page is empty and reads
  *  from it if found empty. If not, it checks if a log-block is mapped to the
  *  data block. the folllowing two conditions are possible :
- *  1.Is a log-block mapped to the data block?
+ *  1.Is there a copy of the page in the log blocks?
  *     1. Yes: Read from the most recent copy in the log block.
  *     2. No: Read from orginal page in data block.
  *
@@ -303,50 +335,23 @@ enum status Ftl::read_event(Event &event,Address* addr_allocate)
    /* Get the LBA */
   unsigned logical_address = event.get_logical_address();
 
-  /* Get the package number, die number, plane number, block number and 
-   * page number from the LBA.
-   */
-  unsigned int package_num,dies_num,plane_num,block_num,page_num;
-  unsigned int package_num_mod,dies_num_mod,plane_num_mod;
-  package_num = GET_DIVIDE_NUM(logical_address,PACKAGE_SIZE * DIE_SIZE * \
-                               PLANE_SIZE * BLOCK_SIZE);
-  package_num_mod = GET_MOD_NUM(logical_address,PACKAGE_SIZE * DIE_SIZE * \
-                                PLANE_SIZE * BLOCK_SIZE);
-  dies_num = GET_DIVIDE_NUM(package_num_mod,DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
-  dies_num_mod = GET_MOD_NUM(package_num_mod,DIE_SIZE * PLANE_SIZE * \
-                             BLOCK_SIZE);
-  plane_num = GET_DIVIDE_NUM(dies_num_mod,PLANE_SIZE * BLOCK_SIZE);
-  plane_num_mod = GET_MOD_NUM(dies_num_mod,PLANE_SIZE * BLOCK_SIZE);
-  block_num = GET_DIVIDE_NUM(plane_num_mod,BLOCK_SIZE);
-  page_num = GET_MOD_NUM(package_num_mod,BLOCK_SIZE);
-
-  
-  if(page_status[logical_address] == 1)
-    {
-      /* Page contains valid data */
+  if(logical_address >= (num_blocks_available * BLOCK_SIZE))
+      return FAILURE;
 
-      int logical_block_number = logical_address/BLOCK_SIZE;
-      if(check_log_block_mapped_data_block(logical_block_number))
-      {
-        /* A log block is mapped to the data block */
-        int page_index;
-        if((page_index = check_page_exists_log_block(logical_block_number,
-                                                    page_num)) != -1)
-        {
-          /* Get the most recent copy of the page from the log block */
-          LOG_BLOCK* log_block = log_block_map.at(logical_block_number);
-          package_num = log_block -> package_num;
-          dies_num = log_block -> die_num;
-          plane_num = log_block -> plane_num;
-          block_num = log_block -> block_num;
-          page_num = page_index;
-        }
+  /* Get the physical address of the page in the data block from the LBA */
+  Address address;
+  get_data_page(logical_address, address);
 
-      }
+  if(page_status[logical_address] == 1)
+    {
+      /* Page contains valid data, get the most recent copy of the page from
+       * the log blocks if there is one.
+       */
+      find_log_page(logical_address, address);
 
-      /* Pack the new address to which the lba will be mapped */
-      *addr_allocate = new Address(package_num,dies_num,plane_num,block_num,
-                                   page_num,PAGE); 
+      /* Return the address to which the lba is mapped */
+      address.valid = PAGE;
+      *addr_allocate = address;
       return SUCCESS;
     }
 
@@ -358,25 +363,164 @@ enum status Ftl::read_event(Event &event,Address* addr_allocate)
 
 }
 
+/** @brief Convert LBA to PBA in case of a write event with FAST
+ *
+ *  The first write of a page goes to its data block as in write_event.
+ *  Rewrites go to a log block:
+ *  1. Page offset 0 starts a new sequential log block for the data block,
+ *     merging the previous sequential log block first.
+ *  2. The next page offset of the data block owning the sequential log block
+ *     is appended to it.
+ *  3. Any other rewrite is appended to the newest random log block, which
+ *     any data block can use. When the random log blocks are full, the
+ *     oldest one is reclaimed, merging the data blocks it holds pages of.
+ *
+ *  @param event Write event.
+ *  @param addr_allocated The address to which LBA is to be mapped.
+ *  @return Success or Failure
+ */
+enum status Ftl::fast_write_event(Event &event,Address* addr_allocate)
+{
+  unsigned long logical_address = event.get_logical_address();
+  if(logical_address >= (num_blocks_available * BLOCK_SIZE))
+      return FAILURE;
+
+  Address address;
+  get_data_page(logical_address, address);
+  unsigned int page_num = address.page;
+  unsigned long logical_block_number = GEOMETRY.get_block(logical_address);
+
+  if(page_status[logical_address] == 0)
+  {
+    /* First write of the page goes to the data block */
+    page_status[logical_address] = 1;
+    address.valid = PAGE;
+    *addr_allocate = address;
+    return SUCCESS;
+  }
+
+  LOG_BLOCK* log_block;
+  int page_index;
+  if(page_num == 0)
+  {
+    /* Start a new sequential log block */
+    if(sequential_log_block != NULL)
+      garbage.merge_sequential_log_block(event);
+    log_block = get_free_log_block(event);
+    log_block -> logical_block = logical_block_number;
+    log_block -> mapped_time = ++log_block_clock;
+    sequential_log_block = log_block;
+    page_index = append_log_block(log_block, page_num, page_num);
+  }
+  else if(sequential_log_block != NULL &&
+          sequential_log_block -> logical_block == logical_block_number &&
+          check_page_empty_log_block(sequential_log_block) == page_num)
+  {
+    /* Append to the sequential log block */
+    log_block = sequential_log_block;
+    page_index = append_log_block(log_block, page_num, page_num);
+  }
+  else
+  {
+    /* Append to the newest random log block */
+    if(random_log_blocks.empty() ||
+       check_page_empty_log_block(random_log_blocks.back()) == (unsigned int) -1)
+      random_log_blocks.push_back(get_free_log_block(event));
+    log_block = random_log_blocks.back();
+    page_index = append_log_block(log_block, logical_address, page_num);
+  }
+
+  log_block -> block.get_address(address);
+  address.page = page_index;
+  address.valid = PAGE;
+  invalidate_latest_page(logical_address);
+  log_page_map[logical_address] = Ppa(address);
+  *addr_allocate = address;
+  return SUCCESS;
+}
+
+/** @brief Get an erased log block for FAST
+ *
+ *  Reclaims the oldest random log block if no log block is free.
+ *
+ *  @param event Write event charged with the reclaim.
+ *  @return Log block
+ */
+LOG_BLOCK* Ftl::get_free_log_block(Event &event)
+{
+  if(free_log_blocks.empty())
+    garbage.reclaim_random_log_block(event);
+  return wear.get_free_log_block();
+}
+
+/** @brief Get the page of the data block a logical page belongs to
+ *
+ *  @param logical_address Logical page.
+ *  @param address Set to the page in the data block.
+ *  @return Void
+ */
+void Ftl::get_data_page(unsigned long logical_address, Address &address)
+{
+  data_block_map[GEOMETRY.get_block(logical_address)].get_address(address);
+  address.page = GEOMETRY.get_page(logical_address);
+  address.valid = PAGE;
+}
+
+/** @brief Mark the latest copy of a page stale before it is rewritten
+ *
+ *  @param logical_address Logical page.
+ *  @return Void
+ */
+void Ftl::invalidate_latest_page(unsigned long logical_address)
+{
+  Address address;
+  if(!find_log_page(logical_address, address))
+    get_data_page(logical_address, address);
+  invalidate_page(address);
+}
+
+/** @brief Find the latest copy of a page in the log blocks
+ *
+ *  @param logical_address Logical page.
+ *  @param address Set to the page in the log block if there is a copy.
+ *  @return true if the log blocks have a copy of the page.
+ */
+bool Ftl::find_log_page(unsigned long logical_address, Address &address)
+{
+  if(FTL_IMPLEMENTATION == FAST)
+  {
+    if(log_page_map[logical_address].get_valid() == NONE)
+      return false;
+    log_page_map[logical_address].get_address(address);
+    return true;
+  }
+
+  unsigned long logical_block_number = GEOMETRY.get_block(logical_address);
+  if(!check_log_block_mapped_data_block(logical_block_number))
+    return false;
+  int page_index = check_page_exists_log_block(logical_block_number,
+                                               GEOMETRY.get_page(logical_address));
+  if(page_index == -1)
+    return false;
+  log_block_map[logical_block_number] -> block.get_address(address);
+  address.page = page_index;
+  address.valid = PAGE;
+  return true;
+}
+
 /** @brief Checks if log block is mapped to a data block.
  *         
- *  Checks if a data block exists as a key in the map using the count
- *  function.
+ *  Checks if the directory has a log block at the data block number.
  *
  *  @param logical_block_num data block to be checked in the map.
  *  @return Success or Failure
  */
 bool Ftl::check_log_block_mapped_data_block(unsigned int logical_block_num)
 {
-  /* Use the count function to find out if a block exists */
-  if(log_block_map.count(logical_block_num) != 0)
-  {
-    /* Ensure that there are no duplicate entries */
-    assert(log_block_map.count(logical_block_num) == 1);
+  if(log_block_map[logical_block_num] != NULL)
     return LOG_BLOCK_MAPPED_SUCCESS;
-  }
 
-    return LOG_BLOCK_MAPPED_FAILURE;
+  return LOG_BLOCK_MAPPED_FAILURE;
 }
 
 /** @brief Checks if an empty page exists in the log block
@@ -388,18 +532,22 @@ bool Ftl::check_log_block_mapped_data_block(unsigned int logical_block_num)
  */
 unsigned int Ftl::check_page_empty_log_block(unsigned int logical_block_num)
 {
-  LOG_BLOCK* log_block = log_block_map.at(logical_block_num);
-
-  for(int index = 0; index < (int)BLOCK_SIZE; index++)
-  {
-    if(log_block -> page_entries[index] == -1)
-      /* There is an empty page at location index */
-      return index;
-  }
-
-  /* No empty page in log block */
-  return -1;
+  return check_page_empty_log_block(log_block_map[logical_block_num]);
+}
 
+/** @brief Checks if an empty page exists in the log block
+ *
+ *  Pages of a log block are written in order, so this is its append cursor.
+ *
+ *  @param log_block Log block to be checked.
+ *  @return index
+ */
+unsigned int Ftl::check_page_empty_log_block(LOG_BLOCK *log_block)
+{
+  if(log_block -> cursor == BLOCK_SIZE)
+    /* No empty page in log block */
+    return -1;
+  return log_block -> cursor;
 }
 
 /** @brief Check if page exists in the log block
@@ -414,147 +562,1111 @@ unsigned int Ftl::check_page_empty_log_block(unsigned int logical_block_num)
 unsigned int Ftl::check_page_exists_log_block(unsigned int logical_block_number,
                                               int page_offset)
 {
-  LOG_BLOCK* log_block = log_block_map.at(logical_block_number);
+  return log_block_map[logical_block_number] -> page_index[page_offset];
+}
 
-  /* Start a loop from beginning from the end of the array so that we can 
-   * find the latest copy of a page.
-   */
-  for(int index = BLOCK_SIZE - 1; index >= 0; index--)
+/** @brief Create an empty log block
+ *
+ *  The log block is numbered as the next one in log_blocks.
+ *
+ *  @param block Physical block of the log block.
+ *  @return Log block
+ */
+LOG_BLOCK* Ftl::create_log_block(const Address &block)
+{
+  LOG_BLOCK* log_block = new LOG_BLOCK;
+  log_block -> block = Ppa(block);
+  log_block -> page_entries = new int[BLOCK_SIZE];
+  log_block -> page_index = new int[BLOCK_SIZE];
+  log_block -> logical_block = 0;
+  log_block -> mapped_time = 0;
+  log_block -> written_time = 0;
+  log_block -> number = log_blocks.size();
+  log_block -> num_written = 0;
+  log_block -> in_order = true;
+  log_block -> merge_cost = 0;
+  reset_log_block(log_block);
+  return log_block;
+}
+
+/** @brief Mark every page of a log block empty
+ *
+ *  @param log_block Log block, erased by the caller.
+ *  @return Void
+ */
+void Ftl::reset_log_block(LOG_BLOCK *log_block)
+{
+  std::fill_n(log_block->page_entries,BLOCK_SIZE, -1);
+  std::fill_n(log_block->page_index,BLOCK_SIZE, -1);
+  log_block -> cursor = 0;
+}
+
+/** @brief Write a page at the append cursor of a log block
+ *
+ *  A BAST log block that gets a page at its own offset saves its merge
+ *  copying that page, any other page makes the merge a full merge.
+ *
+ *  @param log_block Log block with an empty page.
+ *  @param entry Value of the page entry.
+ *  @param page_offset Offset of the page in its data block.
+ *  @return index of the page in the log block
+ */
+unsigned int Ftl::append_log_block(LOG_BLOCK *log_block, int entry, unsigned int page_offset)
+{
+  assert(log_block -> cursor < BLOCK_SIZE);
+  unsigned int index = log_block -> cursor++;
+  log_block -> page_entries[index] = entry;
+  log_block -> page_index[page_offset] = index;
+  log_block -> written_time = ++log_block_clock;
+  if(FTL_IMPLEMENTATION == HYBRID)
   {
-    if((log_block -> page_entries[index]) == page_offset)
-      /* Page exists in log block, return index. */
-      return index;
+    if(log_block -> in_order && entry == (int) index)
+      log_block -> merge_cost--;
+    else if(log_block -> in_order)
+    {
+      log_block -> in_order = false;
+      log_block -> merge_cost = log_block -> num_written;
+    }
+    garbage.index_log_block(log_block);
   }
+  return index;
+}
 
-  return -1;
+/** @brief Free a log block for a write event
+ *
+ *  The merges in progress are finished first. If the data block written by the
+ *  event has a log block, the log block is full and the data block is
+ *  merged. Otherwise, if still no log block is free, a victim data block
+ *  picked with the policy is merged and its log block goes back to the free
+ *  pool.
+ *
+ *  @param event Write event.
+ *  @param policy Policy picking the victim.
+ *  @return Success or Failure
+ */
+enum status Garbage_collector::collect(Event &event, enum GC_POLICY policy)
+{
+  enum status status = SUCCESS;
+  unsigned int logical_block_num = GEOMETRY.get_block(event.get_logical_address());
+
+  request = &event;
+  finish_merge();
+  if(ftl.check_log_block_mapped_data_block(logical_block_num))
+    perform_cleaning(logical_block_num);
+  else if(ftl.free_log_blocks.empty())
+    status = merge_victim(policy);
+  request = NULL;
+  return status;
 }
 
-enum status Garbage_collector::collect(Event &event __attribute__((unused)), enum GC_POLICY policy __attribute__((unused)))
+/** @brief Free log blocks while the drive is idle
+ *
+ *  Victims are merged until watermark percent of the log blocks are free or
+ *  idle_time has passed since the start of the event. Merges that are
+ *  started are finished, so the event can take longer than idle_time.
+ *  BAST merges victims picked with SELECTED_GC_POLICY. FAST reclaims its
+ *  oldest random log blocks but leaves the one being written.
+ *
+ *  @param event Background cleaning event, charged with the merges.
+ *  @param idle_time Time until the next request arrives.
+ *  @param watermark Percentage of the log blocks to free.
+ *  @return Number of log blocks freed
+ */
+unsigned int Garbage_collector::collect_idle(Event &event, double idle_time, float watermark)
 {
-  /*
-   * TODO: Implement garbage collection policies and perform cleaning.
-   */
-   perform_cleaning(event.get_logical_address(),event.get_logical_address() / BLOCK_SIZE);
+  unsigned int freed = 0;
+  unsigned int step;
+  while(event.get_time_taken() < idle_time && (step = collect_idle_step(event, watermark)) > 0)
+    freed += step;
+  return freed;
+}
 
+/** @brief Free log blocks in the background
+ *
+ *  Finishes the merges left unfinished by the requests, then, if fewer than
+ *  watermark percent of the log blocks are free, BAST merges as many victims
+ *  as it takes to reach the watermark, on different dies and at the same
+ *  time, and FAST reclaims one random log block.
+ *
+ *  @param event Background cleaning event, charged with the merges.
+ *  @param watermark Percentage of the log blocks to free.
+ *  @return Number of log blocks freed
+ */
+unsigned int Garbage_collector::collect_idle_step(Event &event, float watermark)
+{
+  unsigned int freed = 0;
+  unsigned int target = (watermark / 100) * ftl.log_blocks.size();
+
+  request = &event;
+  finish_merge();
+  if(ftl.free_log_blocks.size() < target)
+  {
+    if(FTL_IMPLEMENTATION == FAST)
+    {
+      if(ftl.random_log_blocks.size() >= 2)
+      {
+        reclaim_oldest_random_log_block();
+        freed++;
+      }
+    }
+    else
+    {
+      freed = start_victim_merges(event, target, ftl.num_blocks_available);
+      finish_merge();
+    }
+  }
+  request = NULL;
+  return freed;
+}
+
+/** @brief Free log blocks for a throttled write
+ *
+ *  BAST merges victims picked with SELECTED_GC_POLICY, one per die, a page
+ *  at a time until watermark percent of the log blocks are free or hold has
+ *  passed since the start of the event. Merges can be left unfinished, so
+ *  the event takes no longer than hold plus one page or erase on each die.
+ *  The data block written by the event is not merged. FAST reclaims random
+ *  log blocks as when idle.
+ *
+ *  @param event Write request, charged with the merges.
+ *  @param hold Time the request is held for.
+ *  @param watermark Percentage of the log blocks to free.
+ *  @return Void
+ */
+void Garbage_collector::collect_throttled(Event &event, double hold, float watermark)
+{
+  if(FTL_IMPLEMENTATION == FAST)
+  {
+    (void) collect_idle(event, hold, watermark);
+    return;
+  }
+
+  unsigned int logical_block_num = GEOMETRY.get_block(event.get_logical_address());
+  unsigned int target = (watermark / 100) * ftl.log_blocks.size();
+
+  request = &event;
+  (void) finish_merge(logical_block_num);
+  while(event.get_time_taken() < hold)
+  {
+    (void) start_victim_merges(event, target, logical_block_num);
+    if(merges.empty())
+      break;
+    step_merges(1);
+  }
+  request = NULL;
+}
+
+/** @brief Merge a victim data block and free its log block
+ *
+ *  @param policy Policy picking the victim.
+ *  @return Success or Failure if no log block is mapped
+ */
+enum status Garbage_collector::merge_victim(enum GC_POLICY policy)
+{
+  assert(merges.empty());
+  LOG_BLOCK* log_block = select_victim(*request, policy);
+  if(log_block == NULL)
+    return FAILURE;
+  fprintf(log_file, "Garbage_collector: %s: merging logical block %lu\n",
+          __func__, log_block -> logical_block);
+  (void) start_merge(log_block -> logical_block, true);
+  finish_merge();
   return SUCCESS;
 }
 
-void Garbage_collector::perform_cleaning(unsigned long logical_address,unsigned int logical_block_num)
+/** @brief Merge a little for every request once log blocks run low
+ *
+ *  With GC_STEP_PAGES set, BAST starts merging victims picked with
+ *  SELECTED_GC_POLICY, one per die and up to GC_STEP_PAGES of them, when at
+ *  most GC_STEP_WATERMARK percent of the log blocks are free. Every request
+ *  then takes one step of each merge, the merges sharing GC_STEP_PAGES
+ *  pages, so a write has to wait for a whole merge only when its own log
+ *  block is full or no log block is free. A request for a data block being
+ *  merged, incrementally or by write throttling, finishes its merge first.
+ *
+ *  @param event Read or write request, charged with the step.
+ *  @return Void
+ */
+void Garbage_collector::collect_step(Event &event)
 {
+  if(FTL_IMPLEMENTATION != HYBRID)
+    return;
 
-   merge_data_and_log_block(logical_address,logical_block_num);
+  unsigned int logical_block_num = GEOMETRY.get_block(event.get_logical_address());
+  unsigned int target = (GC_STEP_WATERMARK / 100) * ftl.log_blocks.size();
 
-   erase_data_and_log_block(logical_address,logical_block_num);
+  request = &event;
+  if(!finish_merge(logical_block_num) && GC_STEP_PAGES > 0)
+  {
+    (void) start_victim_merges(event, target + 1, logical_block_num, GC_STEP_PAGES);
+    if(!merges.empty())
+      step_merges(std::max(GC_STEP_PAGES / (unsigned int) merges.size(), 1u));
+  }
+  request = NULL;
+}
 
-   copy_cleaning_block_to_data_block(logical_address);
+/** @brief Pick the mapped log block whose data block is merged next
+ *
+ *  FIFO: the log block mapped first.
+ *  LRU: the log block written least recently.
+ *  GREEDY: the data block whose merge copies the fewest pages.
+ *  COST_BENEFIT: the highest (1 - u) * age / (1 + u), where u is the
+ *  fraction of the block the merge copies and age is the time since the log
+ *  block was erased.
+ *  Ties go to the log block mapped first, but for COST_BENEFIT log blocks
+ *  with the same merge cost erased at the same time go to the lower log
+ *  block number. The victim is taken from the index of the policy: the first
+ *  of the lowest bucket, or for COST_BENEFIT the best of the oldest log
+ *  block of each merge cost. Log blocks being merged are not in the index.
+ *
+ *  @param event Write event.
+ *  @param policy Cleaning policy, SELECTED_GC_POLICY.
+ *  @return Log block, NULL if no log block is mapped.
+ */
+LOG_BLOCK* Garbage_collector::select_victim(Event &event, enum GC_POLICY policy)
+{
+  LOG_BLOCK* victim = NULL;
+  unsigned long number;
+  assert(policy == SELECTED_GC_POLICY);
 
-   erase_cleaning_block();
+  if(policy != COST_BENEFIT)
+  {
+    if(victims.get_min(number))
+      victim = ftl.log_blocks[number];
+  }
+  else
+  {
+    double best = 0;
+    double now = event.get_start_time() + event.get_time_taken();
+    for(unsigned int cost = 0; cost <= BLOCK_SIZE; cost++)
+    {
+      if(!victims.get_first(cost, number))
+        continue;
+      LOG_BLOCK* log_block = ftl.log_blocks[number];
+      double utilization = (double) cost / BLOCK_SIZE;
+      double benefit = (1 - utilization) * (now - victims.get_order(number)) / (1 + utilization);
+      if(victim == NULL || benefit > best ||
+         (benefit == best && log_block -> mapped_time < victim -> mapped_time))
+      {
+        victim = log_block;
+        best = benefit;
+      }
+    }
+  }
 
-    return;
+  assert(victim == NULL || (ftl.log_block_map[victim -> logical_block] == victim &&
+         victim -> merge_cost == get_merge_cost(victim -> logical_block, victim)));
+  return victim;
+}
 
+/** @brief Start tracking the merge cost of a BAST log block
+ *
+ *  Called when the log block is mapped to its data block and when a merge
+ *  leaves it mapped and empty, so that a merge would copy every page of the
+ *  data block written so far.
+ *
+ *  @param log_block Log block mapped to its data block.
+ *  @return Void
+ */
+void Garbage_collector::map_log_block(LOG_BLOCK *log_block)
+{
+  unsigned long data_block_address = (unsigned long) log_block -> logical_block * BLOCK_SIZE;
+  log_block -> num_written = 0;
+  for(unsigned int page_offset = 0; page_offset < BLOCK_SIZE; page_offset++)
+    if(ftl.page_status[data_block_address + page_offset] == 1)
+      log_block -> num_written++;
+  log_block -> in_order = true;
+  log_block -> merge_cost = log_block -> num_written;
+  index_log_block(log_block);
 }
 
-void Garbage_collector::merge_data_and_log_block(unsigned long logical_address,unsigned int logical_block_num)
+/** @brief Add a BAST log block to the victims of SELECTED_GC_POLICY, or
+ *         rekey it after a write
+ *
+ *  FIFO and LRU keep the log blocks in one bucket in the order they were
+ *  mapped or last written. GREEDY buckets them by merge cost in the order
+ *  they were mapped, COST_BENEFIT by merge cost in the order they were
+ *  erased.
+ *
+ *  @param log_block Log block mapped to its data block.
+ *  @return Void
+ */
+void Garbage_collector::index_log_block(LOG_BLOCK *log_block)
 {
-  LOG_BLOCK* log_block = ftl.log_block_map.at(logical_block_num);
-  unsigned long log_block_address = GET_LOGICAL_ADDR(log_block->package_num,log_block->die_num,log_block->plane_num,log_block->block_num);
-  int page_index = 0;
-  int page_offset = 0;
-  Address addr_allocate;
-  Event *event = NULL;
+  unsigned int key = 0;
+  double order = log_block -> mapped_time;
+  if(SELECTED_GC_POLICY == GREEDY || SELECTED_GC_POLICY == COST_BENEFIT)
+    key = log_block -> merge_cost;
+  if(SELECTED_GC_POLICY == LRU)
+    order = log_block -> written_time;
+  else if(SELECTED_GC_POLICY == COST_BENEFIT)
+  {
+    /* a log block is only erased while it is out of the index */
+    if(victims.contains(log_block -> number))
+      order = victims.get_order(log_block -> number);
+    else
+      order = ftl.get_last_erase_time(log_block -> block.get_address());
+  }
 
-  for(;page_offset < (int)BLOCK_SIZE;page_offset++)
-   {
-      page_index = ftl.check_page_exists_log_block(logical_block_num,
-                                                    page_offset);
-        if(page_index != -1)
-        {
-          addr_allocate = new Address(log_block->package_num,log_block->die_num,log_block->plane_num,log_block->block_num,page_offset,PAGE);
-          event = new Event(READ,log_block_address + page_index,1,0);
-          event->set_address(&addr_allocate);
-          ftl.controller.issue(*event);
-          addr_allocate = new Address(ftl.cleaning_package_num,ftl.cleaning_dies_num,ftl.cleaning_plane_num,ftl.cleaning_block_num,page_offset,PAGE);
-          event = new Event(WRITE,ftl.cleaning_block_logical_addr + page_offset,1,0);
-          event->set_address(&addr_allocate);
-          ftl.controller.issue(*event);
-        }
+  if(victims.contains(log_block -> number))
+    victims.update(log_block -> number, key, order);
+  else
+    victims.insert(log_block -> number, key, order);
+}
 
-        else
-        {
-          if(ftl.page_status[logical_address + page_offset] == 1)
-          {
-          addr_allocate = new Address(ftl.package_number,ftl.dies_number,ftl.plane_number,ftl.block_number,page_offset,PAGE);
-          event = new Event(READ,logical_address + page_offset,1,0);
-          event->set_address(&addr_allocate);
-          ftl.controller.issue(*event);
-          addr_allocate = new Address(ftl.cleaning_package_num,ftl.cleaning_dies_num,ftl.cleaning_plane_num,ftl.cleaning_block_num,page_offset,PAGE);
-          event = new Event(WRITE,ftl.cleaning_block_logical_addr + page_offset,1,0);
-          event->set_address(&addr_allocate);
-          ftl.controller.issue(*event);
-          }
-        }
+/** @brief Number of pages a merge of a data block copies
+ *
+ *  @param logical_block_num Data block.
+ *  @param log_block Log block of the data block.
+ *  @return Pages copied
+ */
+unsigned int Garbage_collector::get_merge_cost(unsigned int logical_block_num, LOG_BLOCK *log_block)
+{
+  unsigned long data_block_address = (unsigned long) logical_block_num * BLOCK_SIZE;
+  unsigned int page_offset = 0;
+  unsigned int cost = 0;
+
+  /* a switch or partial merge only copies the pages past the log block */
+  if(check_log_block_in_order(logical_block_num, log_block))
+    page_offset = log_block -> cursor;
+  for(; page_offset < BLOCK_SIZE; page_offset++)
+    if(ftl.page_status[data_block_address + page_offset] == 1)
+      cost++;
+  return cost;
+}
 
-    }  
+/** @brief Address of a page in a block
+ *
+ *  @param block Packed address of the block.
+ *  @param page_offset Page within the block.
+ *  @return Page address
+ */
+static Address page_address(const Ppa &block, unsigned int page_offset)
+{
+  Address address = block.get_address();
+  address.page = page_offset;
+  address.valid = PAGE;
+  return address;
 }
 
-void Garbage_collector::erase_data_and_log_block(unsigned long logical_address,unsigned int logical_block_num)
+/** @brief Number of a physical block in the drive
+ *
+ *  @param block Packed address of the block.
+ *  @return Block number
+ */
+static unsigned long block_number(const Ppa &block)
+{
+  return GEOMETRY.get_block(GEOMETRY.compose(block.get_address()));
+}
+
+/** @brief Number of the die of an address in the drive
+ *
+ *  @param address Address within the die.
+ *  @return Die number
+ */
+static unsigned int die_number(const Address &address)
+{
+  return address.package * PACKAGE_SIZE + address.die;
+}
+
+/** @brief Merge a data block with its pages in the log blocks
+ *
+ *  @param logical_block_num Data block to be merged.
+ *  @return Void
+ */
+void Garbage_collector::perform_cleaning(unsigned int logical_block_num)
+{
+  assert(merges.empty());
+  (void) start_merge(logical_block_num, false);
+  finish_merge();
+}
+
+/** @brief Start merging a data block with its pages in the log blocks
+ *
+ *  The cheapest of three merges is picked:
+ *  1. Switch merge: the log block of the data block holds all of its pages
+ *     in order. The log block becomes the data block and the old data block
+ *     is erased.
+ *  2. Partial merge: the log block holds the first pages in order. The
+ *     remaining valid pages are copied to it, then it is switched.
+ *  3. Full merge: the latest copy of every valid page is gathered in a
+ *     cleaning block, which becomes the data block. The old data block is
+ *     erased and takes its place in the pool of cleaning blocks.
+ *  The merge is done by merge_step. Merges of data blocks on different dies
+ *  can run at the same time, each full merge with a cleaning block of its
+ *  own. Until a merge is finished, its data block must not be read or
+ *  written.
+ *
+ *  @param logical_block_num Data block to be merged.
+ *  @param free_log_block Return the log block to the free pool when done.
+ *  @return false if nothing was started because another merge is in
+ *          progress on the die of the data block or no cleaning block is
+ *          free for a full merge
+ */
+bool Garbage_collector::start_merge(unsigned int logical_block_num, bool free_log_block)
 {
-    Address addr_allocate;
-    Event *event = NULL;
+  Merge merge;
+  merge.block = logical_block_num;
+  merge.die = die_number(ftl.data_block_map[logical_block_num].get_address());
+  for(unsigned int i = 0; i < merges.size(); i++)
+    if(merges[i].die == merge.die)
+      return false;
+  merge.log_block = get_log_block(logical_block_num);
+  merge.in_order = merge.log_block != NULL &&
+                   check_log_block_in_order(logical_block_num, merge.log_block);
+  merge.cleaning_block = 0;
+  merge.free_log_block = free_log_block;
+  merge.remapped = false;
+  merge.erases = 0;
+
+  if(merge.in_order)
+  {
+    if(check_page_empty_log_block_full(merge.log_block))
+      num_switch_merges++;
+    else
+      num_partial_merges++;
+    merge.page = merge.log_block -> cursor;
+  }
+  else
+  {
+    merge.cleaning_block = select_cleaning_block(logical_block_num, merge.log_block);
+    if(merge.cleaning_block == ftl.cleaning_blocks.size())
+      return false;
+    num_full_merges++;
+    merge.page = 0;
+  }
+
+  /* the log block is no victim while it is merged */
+  if(merge.log_block != NULL && victims.contains(merge.log_block -> number))
+    victims.remove(merge.log_block -> number);
+  merges.push_back(merge);
+  return true;
+}
 
-    unsigned long data_block_address = (logical_address/BLOCK_SIZE) * BLOCK_SIZE;
-    LOG_BLOCK* log_block = ftl.log_block_map.at(logical_block_num);
-    unsigned long log_block_address = GET_LOGICAL_ADDR(log_block->package_num,log_block->die_num,log_block->plane_num,log_block->block_num);
+/** @brief Start merging victims on the dies without a merge in progress
+ *
+ *  Victims are picked with SELECTED_GC_POLICY until the free log blocks and
+ *  the log blocks being freed reach target or max_merges merges are in
+ *  progress. A victim that cannot be merged now, because of the merges in
+ *  progress or because it is the data block of the request, is passed over
+ *  for the next one, at most once per die.
+ *
+ *  @param event Request the victims are merged for.
+ *  @param target Number of free log blocks to reach.
+ *  @param logical_block_num Data block of the request, not merged.
+ *  @param max_merges Merges in progress at most.
+ *  @return Number of merges started
+ */
+unsigned int Garbage_collector::start_victim_merges(Event &event, unsigned int target, unsigned int logical_block_num, unsigned int max_merges)
+{
+  unsigned int num_dies = SSD_SIZE * PACKAGE_SIZE;
+  unsigned int freeing = 0;
+  unsigned int started = 0;
+  for(unsigned int i = 0; i < merges.size(); i++)
+    if(merges[i].free_log_block)
+      freeing++;
+
+  passed_victims.clear();
+  while(ftl.free_log_blocks.size() + freeing < target && merges.size() < max_merges &&
+        passed_victims.size() < num_dies)
+  {
+    LOG_BLOCK* log_block = select_victim(event, SELECTED_GC_POLICY);
+    if(log_block == NULL)
+      break;
+    if(log_block -> logical_block == logical_block_num ||
+       !start_merge(log_block -> logical_block, true))
+    {
+      victims.remove(log_block -> number);
+      passed_victims.push_back(log_block);
+      continue;
+    }
+    fprintf(log_file, "Garbage_collector: %s: merging logical block %lu\n",
+            __func__, log_block -> logical_block);
+    freeing++;
+    started++;
+  }
+  for(unsigned int i = 0; i < passed_victims.size(); i++)
+    index_log_block(passed_victims[i]);
+  return started;
+}
 
-    addr_allocate = new Address(ftl.package_number,ftl.dies_number,ftl.plane_number,ftl.block_number,0,BLOCK);
-    event = new Event(ERASE,data_block_address,1,0);
-    event->set_address(&addr_allocate);
-    ftl.controller.issue(*event);
-    addr_allocate = new Address(log_block->package_num,log_block->die_num,log_block->plane_num,log_block->block_num,0,BLOCK);
-    event = new Event(ERASE,log_block_address,1,0);
-    event->set_address(&addr_allocate);
-    ftl.controller.issue(*event);
+/** @brief Pick the cleaning block for a full merge
+ *
+ *  A cleaning block on the die of the data block is preferred, then one on
+ *  the die of its log block, so that pages can be copied back on the die.
+ *  Cleaning blocks taken by the merges in progress are passed over. The old
+ *  data block replaces the cleaning block in the pool.
+ *
+ *  @param logical_block_num Data block to be merged.
+ *  @param log_block Log block of the data block or NULL.
+ *  @return Index of the cleaning block, the number of cleaning blocks if
+ *          none is free
+ */
+unsigned int Garbage_collector::select_cleaning_block(unsigned int logical_block_num, LOG_BLOCK *log_block)
+{
+  Address data_block = ftl.data_block_map[logical_block_num].get_address();
+  unsigned int selected = ftl.cleaning_blocks.size();
+  bool log_block_die = false;
+  for(unsigned int i = 0; i < ftl.cleaning_blocks.size(); i++)
+  {
+    bool taken = false;
+    for(unsigned int j = 0; j < merges.size(); j++)
+      if(!merges[j].in_order && merges[j].cleaning_block == i)
+        taken = true;
+    if(taken)
+      continue;
+    if(selected == ftl.cleaning_blocks.size())
+      selected = i;
+
+    Address cleaning_block = ftl.cleaning_blocks[i].get_address();
+    if(cleaning_block.compare(data_block) >= DIE)
+      return i;
+    if(!log_block_die && log_block != NULL &&
+       cleaning_block.compare(log_block -> block.get_address()) >= DIE)
+    {
+      selected = i;
+      log_block_die = true;
+    }
+  }
+  return selected;
 }
 
-void Garbage_collector::copy_cleaning_block_to_data_block(unsigned long logical_address)
+/** @brief Do the next step of a merge
+ *
+ *  A step copies up to max_pages valid pages to the new data block or erases
+ *  one block. The data block is remapped once every page is copied. The
+ *  events of the step are left in the batch.
+ *
+ *  @param merge Merge in progress.
+ *  @param max_pages Pages copied at most.
+ *  @return true if the merge is finished
+ */
+bool Garbage_collector::merge_step(Merge &merge, unsigned int max_pages)
 {
-    int page_offset = 0;
-    Address addr_allocate;
-    Event *event = NULL;
-    unsigned long data_block_address = (logical_address/BLOCK_SIZE) * BLOCK_SIZE;
+  unsigned long data_block_address = (unsigned long) merge.block * BLOCK_SIZE;
 
-    for(page_offset = 0;page_offset < (int)BLOCK_SIZE;page_offset++)
+  if(!merge.remapped)
+  {
+    Ppa target = merge.in_order ? merge.log_block -> block
+                                : ftl.cleaning_blocks[merge.cleaning_block];
+    unsigned int copied = 0;
+    for(; merge.page < BLOCK_SIZE && copied < max_pages; merge.page++)
     {
-      if(ftl.page_status[logical_address + page_offset] == 1)
+      if(ftl.page_status[data_block_address + merge.page] == 1)
       {
-      addr_allocate = new Address(ftl.cleaning_package_num,ftl.cleaning_dies_num,ftl.cleaning_plane_num,ftl.cleaning_block_num,page_offset,PAGE);
-      event = new Event(READ,ftl.cleaning_block_logical_addr + page_offset,1,0);
-      event->set_address(&addr_allocate);
-      ftl.controller.issue(*event);
-      addr_allocate = new Address(ftl.package_number,ftl.dies_number,ftl.plane_number,ftl.block_number,page_offset,PAGE);
-      event = new Event(WRITE,data_block_address + page_offset,1,0);
-      event->set_address(&addr_allocate);
-      ftl.controller.issue(*event);
+        copy_latest_page(data_block_address + merge.page,
+                         page_address(target, merge.page));
+        copied++;
       }
     }
+    if(merge.page < BLOCK_SIZE)
+      return false;
+
+    /* the block the pages were copied to swaps places with the old data
+     * block, which is erased next */
+    remap_data_block(merge.block, merge.in_order ? merge.log_block -> block
+                                                 : ftl.cleaning_blocks[merge.cleaning_block]);
+    merge.remapped = true;
+    if(copied > 0)
+      return false;
+  }
+
+  /* erase the old data block, then the log block of a full merge
+   * the old data block stays in use as a log block or cleaning block */
+  if(merge.erases++ == 0)
+  {
+    Ppa &block = merge.in_order ? merge.log_block -> block
+                                : ftl.cleaning_blocks[merge.cleaning_block];
+    erase_block(block);
+    ftl.wear.swap_free_block(block);
+  }
+  else
+    erase_block(merge.log_block -> block);
+  if(merge.erases == 1 && !merge.in_order && merge.log_block != NULL)
+    return false;
+
+  release_log_block(merge.block, merge.log_block);
+  if(merge.free_log_block)
+  {
+    ftl.log_block_map[merge.block] = NULL;
+    ftl.wear.add_free_log_block(merge.log_block);
+  }
+  else if(FTL_IMPLEMENTATION == HYBRID && merge.log_block != NULL)
+    map_log_block(merge.log_block);
+  return true;
 }
 
-void Garbage_collector::erase_cleaning_block()
+/** @brief Do the next step of every merge in progress
+ *
+ *  The steps are issued together, so that merges on different dies overlap
+ *  and the request waits for the longest. Finished merges are dropped.
+ *
+ *  @param max_pages Pages each merge copies at most.
+ *  @return Void
+ */
+void Garbage_collector::step_merges(unsigned int max_pages)
 {
-    Address addr_allocate;
-    Event *event = NULL;
+  for(unsigned int i = 0; i < merges.size(); )
+  {
+    if(merge_step(merges[i], max_pages))
+      merges.erase(merges.begin() + i);
+    else
+      i++;
+  }
+  issue_events();
+}
 
-    addr_allocate = new Address(ftl.cleaning_package_num,ftl.cleaning_dies_num,ftl.cleaning_plane_num,ftl.cleaning_block_num,0,BLOCK);
-    event = new Event(ERASE,ftl.cleaning_block_logical_addr,1,0);
-    event->set_address(&addr_allocate);
-    ftl.controller.issue(*event);
+/** @brief Finish the merges in progress, if any
+ *
+ *  @return Void
+ */
+void Garbage_collector::finish_merge(void)
+{
+  while(!merges.empty())
+    step_merges(BLOCK_SIZE);
 }
 
+/** @brief Finish the merge of a data block, if any
+ *
+ *  The other merges in progress are left where they are.
+ *
+ *  @param logical_block_num Data block.
+ *  @return true if the data block was being merged
+ */
+bool Garbage_collector::finish_merge(unsigned int logical_block_num)
+{
+  for(unsigned int i = 0; i < merges.size(); i++)
+  {
+    if(merges[i].block != logical_block_num)
+      continue;
+    while(!merge_step(merges[i], BLOCK_SIZE))
+      issue_events();
+    issue_events();
+    merges.erase(merges.begin() + i);
+    return true;
+  }
+  return false;
+}
 
-enum status Wear_leveler::level( Event &event __attribute__((unused)))
+/** @brief Add a single page event for cleaning to the batch
+ *
+ *  The events are taken from the pool of the FTL and linked into one list
+ *  per die: the die of the page they copy to, or else of their address, so
+ *  that the read of a page copied through the controller comes before its
+ *  write. A full batch is issued first.
+ *
+ *  @param type Event type.
+ *  @param logical_address Logical address recorded for the event.
+ *  @param address Physical address.
+ *  @param target Page a MERGE or a READ copies to.
+ *  @return Void
+ */
+void Garbage_collector::add_event(enum event_type type, unsigned long logical_address, const Address &address, const Address &target)
 {
-  /*
-   * TODO: Develop your wear leveling scheme here.
-   */
-  return FAILURE;
+  assert(request != NULL);
+  if(ftl.event_pool.is_full())
+    issue_events();
+  unsigned int die = die_number(target.valid > NONE ? target : address);
+  Event &event = ftl.event_pool.get(type, logical_address, request -> get_start_time() + request -> get_time_taken(), die);
+  event.set_address(address);
+  if(type == MERGE)
+    event.set_merge_address(target);
+}
+
+/** @brief Issue the batch of events for cleaning to the controller
+ *
+ *  The list of each die is issued in one call and its events run one after
+ *  the other, while the lists of different dies overlap on the die and
+ *  channel timelines. The request waits until the last event finishes and
+ *  their bus waits are added to it. A page copied through the controller is
+ *  invalidated once it has been read. The pool is emptied.
+ *
+ *  @return Void
+ */
+void Garbage_collector::issue_events(void)
+{
+  double finish_time = request -> get_start_time() + request -> get_time_taken();
+  for(unsigned int die = 0; die < ftl.event_pool.get_num_lists(); die++)
+  {
+    Event *list = ftl.event_pool.get_list(die);
+    if(list == NULL)
+      continue;
+    ftl.controller.issue(*list);
+    for(Event *cur = list; cur != NULL; cur = cur -> get_next())
+    {
+      if(cur -> get_start_time() + cur -> get_time_taken() > finish_time)
+        finish_time = cur -> get_start_time() + cur -> get_time_taken();
+      (void) request -> incr_bus_wait_time(cur -> get_bus_wait_time());
+      if(cur -> get_event_type() == READ)
+        ftl.invalidate_page(cur -> get_address());
+    }
+  }
+  (void) request -> incr_time_taken(finish_time - request -> get_start_time() - request -> get_time_taken());
+  ftl.event_pool.clear();
+}
+
+/** @brief Move the data of a cold data block to a worn free block
+ *
+ *  Static wear leveling: the pages of the data block held by the given block
+ *  are copied to the most worn free log block, which becomes the data block.
+ *  The given block is erased and returned to the free pool, where it is
+ *  among the first taken for new writes.
+ *
+ *  @param event Request charged with the move.
+ *  @param block Block to be moved off, usually the least worn block.
+ *  @return Failure if the block does not hold a data block without log pages
+ *          or no free block is more than WL_THRESHOLD erases more worn
+ */
+enum status Garbage_collector::migrate(Event &event, const Address &block)
+{
+  enum status status = FAILURE;
+
+  request = &event;
+  finish_merge();
+  unsigned int logical_block_num = ftl.block_owner[GEOMETRY.get_block(GEOMETRY.compose(block))];
+  if(logical_block_num != ftl.num_blocks_available && !ftl.free_log_blocks.empty() &&
+     ftl.get_erases_remaining(block) > ftl.free_log_blocks.rbegin() -> first + WL_THRESHOLD &&
+     get_log_block(logical_block_num) == NULL)
+  {
+    unsigned long data_block_address = (unsigned long) logical_block_num * BLOCK_SIZE;
+    Address address;
+    status = SUCCESS;
+    for(unsigned int page_offset = 0; page_offset < BLOCK_SIZE; page_offset++)
+      if(ftl.find_log_page(data_block_address + page_offset, address))
+        status = FAILURE;
+  }
+  if(status == SUCCESS)
+  {
+    /* the most worn free block is the last one in the pool */
+    std::multimap<unsigned long, LOG_BLOCK*, std::greater<unsigned long> >::iterator worn = std::prev(ftl.free_log_blocks.end());
+    LOG_BLOCK* log_block = worn -> second;
+    ftl.free_log_blocks.erase(worn);
+
+    unsigned long data_block_address = (unsigned long) logical_block_num * BLOCK_SIZE;
+    for(unsigned int page_offset = 0; page_offset < BLOCK_SIZE; page_offset++)
+      if(ftl.page_status[data_block_address + page_offset] == 1)
+        copy_latest_page(data_block_address + page_offset,
+                         page_address(log_block -> block, page_offset));
+    issue_events();
+    remap_data_block(logical_block_num, log_block -> block);
+    erase_block(log_block -> block);
+    issue_events();
+    ftl.wear.add_free_log_block(log_block);
+  }
+  request = NULL;
+  return status;
+}
+
+/** @brief Get the log block a data block can be switched with
+ *
+ *  @param logical_block_num Data block.
+ *  @return The log block mapped to the data block, or the FAST sequential
+ *          log block if it belongs to the data block, NULL otherwise.
+ */
+LOG_BLOCK* Garbage_collector::get_log_block(unsigned int logical_block_num)
+{
+  if(FTL_IMPLEMENTATION == FAST)
+  {
+    if(ftl.sequential_log_block != NULL &&
+       ftl.sequential_log_block -> logical_block == logical_block_num)
+      return ftl.sequential_log_block;
+    return NULL;
+  }
+
+  return ftl.log_block_map[logical_block_num];
+}
+
+/** @brief Checks if a log block can replace its data block
+ *
+ *  Every written page of the log block must hold the latest copy of the page
+ *  at the same offset of the data block.
+ *
+ *  @param logical_block_num Data block.
+ *  @param log_block Log block of the data block.
+ *  @return true if a switch or partial merge is possible
+ */
+bool Garbage_collector::check_log_block_in_order(unsigned int logical_block_num, LOG_BLOCK *log_block)
+{
+  unsigned long data_block_address = (unsigned long) logical_block_num * BLOCK_SIZE;
+  Address address;
+
+  for(unsigned int page_offset = 0; page_offset < log_block -> cursor; page_offset++)
+  {
+    if(log_block -> page_entries[page_offset] != (int) page_offset)
+      return false;
+    if(!ftl.find_log_page(data_block_address + page_offset, address) ||
+       Ppa(address) != Ppa(page_address(log_block -> block, page_offset)))
+      return false;
+  }
+  return true;
+}
+
+/** @brief Checks if a log block has no empty pages left
+ *
+ *  @param log_block Log block to be checked.
+ *  @return true if the log block is full
+ */
+bool Garbage_collector::check_page_empty_log_block_full(LOG_BLOCK *log_block)
+{
+  return log_block -> cursor == BLOCK_SIZE;
+}
+
+/** @brief Copy the latest copy of a valid page
+ *
+ *  A copy within a die is a copyback merge that does not cross the channel.
+ *  Other copies read the page and write it through the controller.
+ *
+ *  @param logical_address Logical page.
+ *  @param target Page to copy to.
+ *  @return Void
+ */
+void Garbage_collector::copy_latest_page(unsigned long logical_address, const Address &target)
+{
+  Address address;
+  if(!ftl.find_log_page(logical_address, address))
+    ftl.get_data_page(logical_address, address);
+  if(address.compare(target) >= DIE)
+  {
+    add_event(MERGE, logical_address, address, target);
+    return;
+  }
+  add_event(READ, logical_address, address, target);
+  add_event(WRITE, logical_address, target);
+}
+
+/** @brief Make a block the data block of a logical block
+ *
+ *  @param logical_block_num Data block.
+ *  @param block New data block, set to the old data block on return.
+ *  @return Void
+ */
+void Garbage_collector::remap_data_block(unsigned int logical_block_num, Ppa &block)
+{
+  Ppa old_block = ftl.data_block_map[logical_block_num];
+  ftl.data_block_map[logical_block_num] = block;
+  ftl.block_owner[block_number(block)] = logical_block_num;
+  ftl.block_owner[block_number(old_block)] = ftl.num_blocks_available;
+  block = old_block;
+}
+
+/** @brief Add the erase of a block to the batch
+ *
+ *  The pages copied out of the block must have been issued already, so that
+ *  the erase starts when they are done.
+ *
+ *  @param block Block to be erased.
+ *  @return Void
+ */
+void Garbage_collector::erase_block(const Ppa &block)
+{
+  Address address = block.get_address();
+  add_event(ERASE, GEOMETRY.compose(address), address);
+}
+
+/** @brief Forget the log pages of a merged data block
+ *
+ *  The log block of the data block is erased by now. A BAST log block stays
+ *  mapped to the data block, with the least worn free block if it is less
+ *  worn, and a FAST sequential log block goes back to the free pool. Copies
+ *  in the FAST random log blocks are stale.
+ *
+ *  @param logical_block_num Data block.
+ *  @param log_block Log block of the data block or NULL.
+ *  @return Void
+ */
+void Garbage_collector::release_log_block(unsigned int logical_block_num, LOG_BLOCK *log_block)
+{
+  if(log_block != NULL)
+    ftl.reset_log_block(log_block);
+
+  if(FTL_IMPLEMENTATION != FAST)
+  {
+    if(log_block != NULL)
+      ftl.wear.swap_free_block(log_block -> block);
+    return;
+  }
+
+  unsigned long data_block_address = (unsigned long) logical_block_num * BLOCK_SIZE;
+  for(unsigned int page_offset = 0; page_offset < BLOCK_SIZE; page_offset++)
+    ftl.log_page_map[data_block_address + page_offset] = Ppa();
+  if(log_block != NULL)
+  {
+    ftl.sequential_log_block = NULL;
+    ftl.wear.add_free_log_block(log_block);
+  }
+}
+
+/** @brief Erase a FAST log block and return it to the free pool
+ *
+ *  @param log_block Log block to be erased.
+ *  @return Void
+ */
+void Garbage_collector::erase_log_block(LOG_BLOCK *log_block)
+{
+  erase_block(log_block -> block);
+  issue_events();
+  ftl.reset_log_block(log_block);
+  ftl.wear.add_free_log_block(log_block);
+}
+
+/** @brief Merge the data block owning the FAST sequential log block
+ *
+ *  @param event Write event charged with the merge.
+ *  @return Void
+ */
+void Garbage_collector::merge_sequential_log_block(Event &event)
+{
+  assert(ftl.sequential_log_block != NULL);
+  request = &event;
+  finish_merge();
+  perform_cleaning(ftl.sequential_log_block -> logical_block);
+  request = NULL;
+  assert(ftl.sequential_log_block == NULL);
+}
+
+/** @brief Reclaim the oldest FAST random log block
+ *
+ *  @param event Write event charged with the merges.
+ *  @return Void
+ */
+void Garbage_collector::reclaim_random_log_block(Event &event)
+{
+  request = &event;
+  finish_merge();
+  reclaim_oldest_random_log_block();
+  request = NULL;
+}
+
+/** @brief Reclaim the oldest FAST random log block
+ *
+ *  Every data block with a latest copy of a page in the log block is merged,
+ *  which leaves only stale pages in it, then the log block is erased.
+ *  Merges are deferred until this point, so pages of a data block spread
+ *  over several random log blocks are merged once.
+ *
+ *  @return Void
+ */
+void Garbage_collector::reclaim_oldest_random_log_block(void)
+{
+  assert(!ftl.random_log_blocks.empty());
+  LOG_BLOCK* log_block = ftl.random_log_blocks.front();
+  ftl.random_log_blocks.pop_front();
+
+  for(unsigned int page_index = 0; page_index < log_block -> cursor; page_index++)
+  {
+    int logical_address = log_block -> page_entries[page_index];
+    if(ftl.log_page_map[logical_address] ==
+       Ppa(page_address(log_block -> block, page_index)))
+      perform_cleaning(GEOMETRY.get_block(logical_address));
+  }
+  erase_log_block(log_block);
+}
+
+/** @brief Level the wear while the drive is idle
+ *
+ *  Static wear leveling: as long as the most worn block has been erased more
+ *  than WL_THRESHOLD times more than the least worn block, the data of the
+ *  least worn block is moved so that the block can take new writes. The
+ *  moves take at most WL_RATE percent of the time since the first call, and
+ *  stop once the block to move cannot be moved or idle_time has passed since
+ *  the start of the event.
+ *
+ *  @param event Background event charged with the moves.
+ *  @param idle_time Time the drive is idle for.
+ *  @return Number of blocks moved
+ */
+unsigned int Wear_leveler::level(Event &event, double idle_time)
+{
+  unsigned int moved = 0;
+  while(event.get_time_taken() < idle_time && level_step(event) == SUCCESS)
+    moved++;
+  return moved;
+}
+
+/** @brief Move the data of the least worn block if the wear is uneven
+ *
+ *  The time budget of the moves is topped up with WL_RATE percent of the
+ *  time since the last call, leaving out the time the moves took.
+ *
+ *  @param event Background event charged with the move.
+ *  @return Success or Failure if no block was moved
+ */
+enum status Wear_leveler::level_step(Event &event)
+{
+  if(WL_THRESHOLD == 0)
+    return FAILURE;
+
+  double now = event.get_start_time() + event.get_time_taken();
+  budget += (now - budget_time) * WL_RATE / 100;
+  budget_time = now;
+  if(budget <= 0)
+    return FAILURE;
+
+  Address least_worn;
+  Address most_worn;
+  ftl.get_least_worn(least_worn);
+  ftl.get_most_worn(most_worn);
+  if(ftl.get_erases_remaining(least_worn) - ftl.get_erases_remaining(most_worn) <= WL_THRESHOLD)
+    return FAILURE;
+
+  enum status status = ftl.page_ftl != NULL ? ftl.page_ftl -> migrate(event, least_worn)
+                                            : ftl.garbage.migrate(event, least_worn);
+  budget -= event.get_start_time() + event.get_time_taken() - now;
+  budget_time = event.get_start_time() + event.get_time_taken();
+  if(status == FAILURE)
+    return FAILURE;
+  fprintf(log_file, "Wear_leveler: %s: moved the data of block (%u, %u, %u, %u)\n",
+      __func__, least_worn.package, least_worn.die, least_worn.plane, least_worn.block);
+  num_migrations++;
+  return SUCCESS;
+}
+
+/** @brief Return an erased log block to the free pool
+ *
+ *  The pool is ordered on the erases remaining of each block, read once
+ *  here since a free block is not erased again until it is used.
+ *
+ *  @param log_block Erased log block.
+ *  @return Void
+ */
+void Wear_leveler::add_free_log_block(LOG_BLOCK *log_block)
+{
+  unsigned long erases_remaining = ftl.get_erases_remaining(log_block -> block.get_address());
+  (void) ftl.free_log_blocks.insert(std::make_pair(erases_remaining, log_block));
+}
+
+/** @brief Swap an erased block that stays in use with the least worn free block
+ *
+ *  Blocks erased by a merge that are reused right away, such as a BAST log
+ *  block that stays mapped to its data block or an old data block that
+ *  becomes a cleaning block, would never rest in the free pool. Such a block
+ *  is swapped for the least worn free block if that one has more erases
+ *  remaining.
+ *
+ *  @param block Erased block, set to the free block it is swapped for.
+ *  @return Void
+ */
+void Wear_leveler::swap_free_block(Ppa &block)
+{
+  if(ftl.free_log_blocks.empty() ||
+     ftl.free_log_blocks.begin() -> first <= ftl.get_erases_remaining(block.get_address()))
+    return;
+  LOG_BLOCK* free_log_block = get_free_log_block();
+  std::swap(free_log_block -> block, block);
+  add_free_log_block(free_log_block);
+}
+
+/** @brief Take the least worn log block from the free pool
+ *
+ *  Dynamic wear leveling: every new log block is the free block with the
+ *  most erases remaining, the one returned first among equals.
+ *
+ *  @return Log block
+ */
+LOG_BLOCK* Wear_leveler::get_free_log_block(void)
+{
+  assert(!ftl.free_log_blocks.empty());
+  LOG_BLOCK* log_block = ftl.free_log_blocks.begin() -> second;
+  ftl.free_log_blocks.erase(ftl.free_log_blocks.begin());
+  return log_block;
 }
@@ -0,0 +1,150 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_victim_index.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Victim_index class
+ *
+ * Bucket index over the fully written blocks of a plane keyed by their number
+ * of valid pages.  Each bucket is a doubly linked list threaded through the
+ * next and prev arrays, so blocks are added, removed and rekeyed in constant
+ * time.  Writes and invalidations change a key by one, so the lowest
+ * non-empty bucket is kept up to date by stepping at most max_key buckets.
+ * size is used as the end of list marker and max_key + 1 as the key of
+ * blocks that are not in the index. */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+Victim_index::Victim_index(unsigned int size, unsigned int max_key):
+	size(size),
+	max_key(max_key),
+	min_key(max_key + 1),
+
+	/* use const pointers to use as arrays
+	 * but like a reference, we cannot reseat the pointers */
+	key((unsigned int *) malloc(size * sizeof(unsigned int))),
+	next((unsigned int *) malloc(size * sizeof(unsigned int))),
+	prev((unsigned int *) malloc(size * sizeof(unsigned int))),
+	head((unsigned int *) malloc((max_key + 1) * sizeof(unsigned int)))
+{
+	unsigned int i;
+
+	assert(size > 0);
+	if(key == NULL || next == NULL || prev == NULL || head == NULL)
+	{
+		fprintf(stderr, "Victim_index error: %s: constructor unable to allocate victim index\n", __func__);
+		exit(MEM_ERR);
+	}
+
+	/* all blocks start erased */
+	for(i = 0; i < size; i++)
+		key[i] = max_key + 1;
+	for(i = 0; i <= max_key; i++)
+		head[i] = size;
+	return;
+}
+
+Victim_index::~Victim_index(void)
+{
+	free(key);
+	free(next);
+	free(prev);
+	free(head);
+	return;
+}
+
+/* add a block that was just fully written */
+void Victim_index::insert(unsigned int child, unsigned int key)
+{
+	assert(child < size && key <= max_key && !contains(child));
+	link(child, key);
+	return;
+}
+
+/* drop an erased block */
+void Victim_index::remove(unsigned int child)
+{
+	assert(child < size && contains(child));
+	unlink(child);
+	key[child] = max_key + 1;
+	return;
+}
+
+/* move a block to the bucket for its new number of valid pages */
+void Victim_index::update(unsigned int child, unsigned int key)
+{
+	assert(child < size && key <= max_key && contains(child));
+	unlink(child);
+	link(child, key);
+	return;
+}
+
+bool Victim_index::contains(unsigned int child) const
+{
+	assert(child < size);
+	return key[child] <= max_key;
+}
+
+/* returns the block with the fewest valid pages or size if there is none
+ * ties go to the block that got its key most recently */
+unsigned int Victim_index::get_min(void) const
+{
+	if(min_key > max_key)
+		return size;
+	return head[min_key];
+}
+
+/* returns max_key + 1 if there is no block */
+unsigned int Victim_index::get_min_key(void) const
+{
+	return min_key;
+}
+
+void Victim_index::link(unsigned int child, unsigned int key)
+{
+	this -> key[child] = key;
+	prev[child] = size;
+	next[child] = head[key];
+	if(head[key] != size)
+		prev[head[key]] = child;
+	head[key] = child;
+	if(key < min_key)
+		min_key = key;
+	return;
+}
+
+void Victim_index::unlink(unsigned int child)
+{
+	unsigned int key = this -> key[child];
+	if(prev[child] == size)
+		head[key] = next[child];
+	else
+		next[prev[child]] = next[child];
+	if(next[child] != size)
+		prev[next[child]] = prev[child];
+
+	/* step up to the next non-empty bucket */
+	if(key == min_key)
+		while(min_key <= max_key && head[min_key] == size)
+			min_key++;
+	return;
+}
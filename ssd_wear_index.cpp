@@ -0,0 +1,142 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_wear_index.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Wear_index class
+ *
+ * Tournament tree over the wear of the children of a hardware unit.  Planes,
+ * Dies, Packages and the Ssd each keep one so that their least worn and most
+ * worn children can be found in constant time and updated in O(log n) after
+ * an erase.
+ *
+ * The tree is stored implicitly: leaf i (child i) is node size + i and the
+ * parent of node n is node n / 2, so internal nodes 1 to size - 1 hold the
+ * winner of the match between their two subtrees.  This works for any size,
+ * not only powers of two. */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+Wear_index::Wear_index(unsigned int size, unsigned long erases_remaining):
+	size(size),
+
+	/* use const pointers to use as arrays
+	 * but like a reference, we cannot reseat the pointers */
+	max_key((unsigned long *) malloc(size * sizeof(unsigned long))),
+	min_key((unsigned long *) malloc(size * sizeof(unsigned long))),
+	max_tree((unsigned int *) malloc(size * sizeof(unsigned int))),
+	min_tree((unsigned int *) malloc(size * sizeof(unsigned int)))
+{
+	unsigned int i;
+
+	assert(size > 0);
+	if(max_key == NULL || min_key == NULL || max_tree == NULL || min_tree == NULL)
+	{
+		fprintf(stderr, "Wear_index error: %s: constructor unable to allocate wear index\n", __func__);
+		exit(MEM_ERR);
+	}
+
+	/* all children start with the same wear so the first one wins */
+	for(i = 0; i < size; i++)
+	{
+		max_key[i] = erases_remaining;
+		min_key[i] = erases_remaining;
+	}
+	for(i = size - 1; i > 0; i--)
+	{
+		max_tree[i] = winner(max_tree, max_key, i, true);
+		min_tree[i] = winner(min_tree, min_key, i, false);
+	}
+	return;
+}
+
+Wear_index::~Wear_index(void)
+{
+	free(max_key);
+	free(min_key);
+	free(max_tree);
+	free(min_tree);
+	return;
+}
+
+/* play the match at an internal node between the winners of its subtrees
+ * max selects the child with the most erases remaining, otherwise the child
+ * with the fewest erases remaining wins */
+unsigned int Wear_index::winner(const unsigned int *tree, const unsigned long *key, unsigned int node, bool max) const
+{
+	unsigned int left = 2 * node;
+	unsigned int right = left + 1;
+	left = left >= size ? left - size : tree[left];
+	right = right >= size ? right - size : tree[right];
+
+	if(key[left] == key[right])
+		return left < right ? left : right;
+	else if((key[left] > key[right]) == max)
+		return left;
+	else
+		return right;
+}
+
+/* update the wear of a child and replay its matches up to the root */
+void Wear_index::update(unsigned int child, unsigned long max_erases_remaining, unsigned long min_erases_remaining)
+{
+	unsigned int node;
+
+	assert(child < size && min_erases_remaining <= max_erases_remaining);
+	max_key[child] = max_erases_remaining;
+	min_key[child] = min_erases_remaining;
+	for(node = (child + size) / 2; node > 0; node /= 2)
+	{
+		max_tree[node] = winner(max_tree, max_key, node, true);
+		min_tree[node] = winner(min_tree, min_key, node, false);
+	}
+	return;
+}
+
+/* update a child from the root of the child's own wear index */
+void Wear_index::update(unsigned int child, const Wear_index &child_index)
+{
+	update(child, child_index.get_max_erases_remaining(), child_index.get_min_erases_remaining());
+	return;
+}
+
+/* child with the most erases remaining */
+unsigned int Wear_index::get_least_worn(void) const
+{
+	return size == 1 ? 0 : max_tree[1];
+}
+
+/* child with the fewest erases remaining */
+unsigned int Wear_index::get_most_worn(void) const
+{
+	return size == 1 ? 0 : min_tree[1];
+}
+
+unsigned long Wear_index::get_max_erases_remaining(void) const
+{
+	return max_key[get_least_worn()];
+}
+
+unsigned long Wear_index::get_min_erases_remaining(void) const
+{
+	return min_key[get_most_worn()];
+}
@@ -34,7 +34,10 @@ using namespace ssd;
 
 Wear_leveler::Wear_leveler(Ftl &ftl, FILE *log_file):
   log_file(log_file),
-  ftl(ftl)
+  ftl(ftl),
+  num_migrations(0),
+  budget(0.0),
+  budget_time(0.0)
 {
 	return;
 }
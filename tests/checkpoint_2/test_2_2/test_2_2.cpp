@@ -96,7 +96,9 @@ int main(int argc, char *argv[])
     fprintf(log_file_stream, "Error reading LBA %lu\n", lba);
     failed(ssd);
   }
-  if(ref_addr != address) {
+  /* a merge moves the data to another block, so check that the block LBA 0
+   * was first written to is the one that was cleaned */
+  if(ssd->get_block_erase_count(ref_addr) == 0) {
     fprintf(log_file_stream, "Maybe you cleaned the wrong block?\n");
     failed(ssd);
   }
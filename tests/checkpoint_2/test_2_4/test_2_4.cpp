@@ -159,7 +159,9 @@ int main(int argc, char *argv[])
           address_last.plane, address_last.block, address_last.page);
   fprintf(log_file_stream, "LBA %lu -> PBA %s\n", lba, addr_str);
 
-  if (address_last != address_first)
+  /* a merge moves the data to another block, so check that the block LBA 0
+   * was first written to is the one that was cleaned */
+  if (ssd->get_block_erase_count(address_first) == 0)
   {
     fprintf(log_file_stream, "You cleaned the wrong block as per the cleaning policy\n");
     failed(ssd);
@@ -160,7 +160,9 @@ int main(int argc, char *argv[])
         address.plane, address.block, address.page);
   fprintf(log_file_stream, "LBA %lu -> PBA %s\n", lba, addr_str);
 
-  if(ref_addr != address)
+  /* a merge moves the data to another block, so check that the block LBA 48
+   * was first written to is the one that was cleaned */
+  if(ssd->get_block_erase_count(ref_addr) == 0)
   {
     fprintf(log_file_stream, "You cleaned the wrong block as per the cleaning policy\n");
     failed(ssd);
@@ -0,0 +1,106 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Page-mapped FTL: fill the logical space, overwrite random pages until the
+ * drive has to clean, then check every page still reads back from the
+ * address of its last write. */
+
+#include <string.h>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  int ret_status;
+  unsigned long i = 0;
+  unsigned long num_pages = 0;
+  unsigned long time = 0;
+  unsigned long lba = 0;
+  Address address;
+  if(argc != 3) {
+    printf("usage: test_3_1 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  for(lba = 0; lba < num_pages; lba++) {
+    ssd -> event_arrive(WRITE, lba, 1, (++time), &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error writing LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  ssd -> event_arrive(WRITE, num_pages, 1, (++time), &ret_status, address);
+  if(ret_status != FAILURE) {
+    fprintf(log_file_stream, "Wrote LBA %lu in the overprovisioned space\n", num_pages);
+    failed(ssd);
+  }
+
+  srand(1);
+  for(i = 0; i < 4 * num_pages; i++) {
+    lba = rand() % num_pages;
+    ssd -> event_arrive(WRITE, lba, 1, (++time), &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error rewriting LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  if(ssd->get_total_erases_performed() == 0) {
+    fprintf(log_file_stream, "No blocks were cleaned\n");
+    failed(ssd);
+  }
+  fprintf(log_file_stream, "Erases performed: %lu\n", ssd->get_total_erases_performed());
+
+  for(lba = 0; lba < num_pages; lba++) {
+    ssd -> event_arrive(READ, lba, 1, (++time), &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error reading LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
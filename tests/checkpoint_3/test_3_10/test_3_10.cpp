@@ -0,0 +1,108 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Static wear leveling: a page-mapped drive is filled, then only a tenth of
+ * it is rewritten, with idle periods between the writes.  Without leveling
+ * the blocks of the cold nine tenths are never erased while the hot blocks
+ * wear out.  The most worn block must stay within twice WL_THRESHOLD erases
+ * of the mean, and every page must still read back from the address of its
+ * last write. */
+
+#include <string.h>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  int ret_status;
+  unsigned long i = 0;
+  unsigned long num_pages = 0;
+  double time = 0;
+  double mean_erases = 0;
+  unsigned long lba = 0;
+  Address address;
+  if(argc != 3) {
+    printf("usage: test_3_10 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error writing LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  srand(1);
+  for(i = 0; i < 4 * num_pages; i++) {
+    lba = rand() % (num_pages / 10);
+    time += ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error rewriting LBA %lu\n", lba);
+      failed(ssd);
+    }
+    time += 2 * GC_IDLE_THRESHOLD;
+  }
+
+  mean_erases = (double) ssd->get_total_erases_performed() / (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE);
+  fprintf(log_file_stream, "Erases performed: %lu\n", ssd->get_total_erases_performed());
+  fprintf(log_file_stream, "Mean erases: %f\n", mean_erases);
+  fprintf(log_file_stream, "Max erases: %lu\n", ssd->get_max_num_erases());
+  if(ssd->get_max_num_erases() > mean_erases + 2 * WL_THRESHOLD) {
+    fprintf(log_file_stream, "The most worn block is too far above the mean\n");
+    failed(ssd);
+  }
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(READ, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error reading LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
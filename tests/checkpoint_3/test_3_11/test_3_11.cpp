@@ -0,0 +1,114 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Write streams: a page-mapped drive is filled, then nine in ten writes go to
+ * a tenth of it.  With the hot and cold pages in blocks of their own, the
+ * write amplification measured over the second half of the rewrites, pages
+ * written to flash per host write counted from the erases, must stay below 4,
+ * where a single write frontier gets about 4.5 on this drive, and every page
+ * must still read back from the address of its last write. */
+
+#include <string.h>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  int ret_status;
+  unsigned long i = 0;
+  unsigned long num_pages = 0;
+  unsigned long num_writes = 0;
+  unsigned long erases = 0;
+  double time = 0;
+  double write_amplification = 0;
+  unsigned long lba = 0;
+  Address address;
+  if(argc != 3) {
+    printf("usage: test_3_11 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error writing LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  srand(1);
+  num_writes = 16 * num_pages;
+  for(i = 0; i < num_writes; i++) {
+    if(i == num_writes / 2)
+      erases = ssd->get_total_erases_performed();
+    if(rand() % 10 < 9)
+      lba = rand() % (num_pages / 10);
+    else
+      lba = num_pages / 10 + rand() % (num_pages - num_pages / 10);
+    time += ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error rewriting LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  write_amplification = (double) (ssd->get_total_erases_performed() - erases) * BLOCK_SIZE / (num_writes / 2);
+  fprintf(log_file_stream, "Erases performed: %lu\n", ssd->get_total_erases_performed());
+  fprintf(log_file_stream, "Write amplification: %f\n", write_amplification);
+  if(write_amplification >= 4) {
+    fprintf(log_file_stream, "Write amplification is too high\n");
+    failed(ssd);
+  }
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(READ, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error reading LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
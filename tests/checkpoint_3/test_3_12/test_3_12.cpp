@@ -0,0 +1,126 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Write throttling: a page-mapped drive is filled, then overwritten at random
+ * four times over, each write arriving as the previous one completes.  With
+ * the cleaning spread over throttled writes, no write may take twice
+ * THROTTLE_DELAY or more, the throughput of every eighth of a drive write
+ * after the first must stay within a fifth of the mean, and every page must
+ * still read back from the address of its last write. */
+
+#include <string.h>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  int ret_status;
+  unsigned long i = 0;
+  unsigned long num_pages = 0;
+  unsigned long num_writes = 0;
+  unsigned long window = 0;
+  double time = 0;
+  double window_start = 0;
+  double mean_throughput = 0;
+  std::vector<double> throughputs;
+  unsigned long lba = 0;
+  Address address;
+  if(argc != 3) {
+    printf("usage: test_3_12 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error writing LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  srand(1);
+  num_writes = 4 * num_pages;
+  window = num_pages / 8;
+  window_start = time;
+  for(i = 0; i < num_writes; i++) {
+    lba = rand() % num_pages;
+    time += ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error rewriting LBA %lu\n", lba);
+      failed(ssd);
+    }
+    if((i + 1) % window == 0) {
+      throughputs.push_back(window / (time - window_start));
+      window_start = time;
+    }
+  }
+
+  ssd -> print_latency_histogram(log_file_stream);
+  if(ssd->get_latency_percentile(WRITE, 100) >= 2 * THROTTLE_DELAY) {
+    fprintf(log_file_stream, "A write took too long\n");
+    failed(ssd);
+  }
+
+  for(i = 1; i < throughputs.size(); i++)
+    mean_throughput += throughputs[i] / (throughputs.size() - 1);
+  fprintf(log_file_stream, "Mean throughput: %f writes per time unit\n", mean_throughput);
+  for(i = 1; i < throughputs.size(); i++) {
+    fprintf(log_file_stream, "Window %lu throughput: %f\n", i, throughputs[i]);
+    if(throughputs[i] < 0.8 * mean_throughput || throughputs[i] > 1.2 * mean_throughput) {
+      fprintf(log_file_stream, "Throughput is not steady\n");
+      failed(ssd);
+    }
+  }
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(READ, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error reading LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
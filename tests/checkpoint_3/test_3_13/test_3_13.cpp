@@ -0,0 +1,138 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Bus channel contention: a page-mapped drive is filled with each write
+ * arriving as the previous one completes, which must not wait for the bus.
+ * Then every page is read at the same time.  A read sends its command over
+ * the channel, reads the page from the die and sends the data back, so the
+ * reads to the packages of a channel take turns on it.  The first read of
+ * each die does not wait for the die and must take as long as an
+ * uncontended read plus its wait for the channel.  A channel carries one
+ * transfer at a time, so the last read on a channel of k reads cannot
+ * complete before k command and data transfers have gone over it, and as the
+ * reads keep it busy, it completes no more than an uncontended read later. */
+
+#include <string.h>
+#include <set>
+#include <vector>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  int ret_status;
+  unsigned long i = 0;
+  unsigned long num_pages = 0;
+  double time = 0;
+  double time_taken = 0;
+  double read_time = 0;
+  double transfer = 0;
+  double total_wait = 0;
+  unsigned long die = 0;
+  std::vector<unsigned long> channel_reads;
+  std::vector<double> channel_finish;
+  std::set<unsigned long> die_read;
+  unsigned long lba = 0;
+  Address address;
+  if(argc != 3) {
+    printf("usage: test_3_13 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error writing LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+  if(ssd->get_total_bus_wait_time() != 0) {
+    fprintf(log_file_stream, "Writes arriving one after the other waited for the bus\n");
+    failed(ssd);
+  }
+
+  transfer = BUS_CTRL_DELAY + BUS_DATA_DELAY;
+  channel_reads.resize(SSD_SIZE, 0);
+  channel_finish.resize(SSD_SIZE, 0);
+  for(lba = 0; lba < num_pages; lba++) {
+    time_taken = ssd -> event_arrive(READ, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error reading LBA %lu\n", lba);
+      failed(ssd);
+    }
+    if(lba == 0)
+      read_time = time_taken;
+    die = address.package * PACKAGE_SIZE + address.die;
+    if(time_taken < read_time + ssd->get_last_bus_wait_time() ||
+       (die_read.count(die) == 0 && time_taken != read_time + ssd->get_last_bus_wait_time())) {
+      fprintf(log_file_stream, "Read of LBA %lu took %f after waiting %f for channel %u\n", lba, time_taken, ssd->get_last_bus_wait_time(), address.package);
+      failed(ssd);
+    }
+    die_read.insert(die);
+    total_wait += ssd->get_last_bus_wait_time();
+    channel_reads[address.package]++;
+    if(time_taken > channel_finish[address.package])
+      channel_finish[address.package] = time_taken;
+  }
+
+  ssd -> print_latency_histogram(log_file_stream);
+  for(i = 0; i < channel_reads.size(); i++) {
+    fprintf(log_file_stream, "Channel %lu reads: %lu, last done after %f\n", i, channel_reads[i], channel_finish[i]);
+    if(channel_finish[i] < channel_reads[i] * transfer) {
+      fprintf(log_file_stream, "Channel %lu carried %lu reads in less than %f\n", i, channel_reads[i], channel_reads[i] * transfer);
+      failed(ssd);
+    }
+    if(channel_finish[i] > channel_reads[i] * transfer + read_time) {
+      fprintf(log_file_stream, "Channel %lu was left idle while reads waited for it\n", i);
+      failed(ssd);
+    }
+  }
+  if(total_wait == 0 || ssd->get_total_bus_wait_time() != total_wait) {
+    fprintf(log_file_stream, "Reads waited %f for the bus, %f by read\n", ssd->get_total_bus_wait_time(), total_wait);
+    failed(ssd);
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
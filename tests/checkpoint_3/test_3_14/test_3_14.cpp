@@ -0,0 +1,112 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Die contention: a page-mapped drive without bus delays is filled with each
+ * write arriving as the previous one completes, then every page is read at
+ * the same time.  A die runs one read at a time, so the k-th read on a die
+ * takes k - 1 page reads longer than the first, while reads on different
+ * dies overlap: the last read completes after as many page reads as the most
+ * loaded die has, not after all of them. */
+
+#include <string.h>
+#include <map>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  int ret_status;
+  unsigned long num_pages = 0;
+  unsigned long die = 0;
+  unsigned long max_die_reads = 0;
+  double time = 0;
+  double time_taken = 0;
+  double read_time = 0;
+  std::map<unsigned long, unsigned long> die_reads;
+  unsigned long lba = 0;
+  Address address;
+  if(argc != 3) {
+    printf("usage: test_3_14 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error writing LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time_taken = ssd -> event_arrive(READ, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error reading LBA %lu\n", lba);
+      failed(ssd);
+    }
+    if(lba == 0)
+      read_time = time_taken;
+    die = address.package * PACKAGE_SIZE + address.die;
+    if(time_taken != read_time + die_reads[die] * PAGE_READ_DELAY) {
+      fprintf(log_file_stream, "Read of LBA %lu on die %lu took %f after %lu reads on the die\n", lba, die, time_taken, die_reads[die]);
+      failed(ssd);
+    }
+    if(++die_reads[die] > max_die_reads)
+      max_die_reads = die_reads[die];
+  }
+
+  ssd -> print_latency_histogram(log_file_stream);
+  fprintf(log_file_stream, "Dies read: %lu, most reads on a die: %lu\n", (unsigned long) die_reads.size(), max_die_reads);
+  if(die_reads.size() != SSD_SIZE * PACKAGE_SIZE) {
+    fprintf(log_file_stream, "The reads did not go to every die\n");
+    failed(ssd);
+  }
+  if(ssd->get_latency_percentile(READ, 100) != read_time + (max_die_reads - 1) * PAGE_READ_DELAY) {
+    fprintf(log_file_stream, "Reads on different dies did not overlap\n");
+    failed(ssd);
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
@@ -0,0 +1,207 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Discrete event simulation: a page-mapped drive is filled, read and half
+ * rewritten with every request of a phase submitted at the same time.  Each
+ * request must complete exactly once, no earlier than it arrived, and
+ * completions must come in the order the requests finish.  The reads queue
+ * on their dies as in test 3_14, so they finish out of submission order.
+ * Once the rewrites complete, the drive is left idle and must clean in the
+ * background in steps scheduled after GC_IDLE_THRESHOLD.  All of that
+ * cleaning is hidden, while a request that arrives during a step must take
+ * the rest of the step out of the hidden cleaning time. */
+
+#include <string.h>
+#include <map>
+#include <vector>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+/* collect the completions of the requests with ids first to first + count - 1
+ * returns the number of completions that came before one submitted earlier */
+unsigned long drain(Ssd *ssd, unsigned long first, unsigned long count, std::vector<Request> &done) {
+  Request request;
+  std::vector<bool> seen(count, false);
+  double last_finish = 0;
+  unsigned long overtaken = 0;
+  unsigned long last_id = first;
+  done.clear();
+  while(ssd -> get_completion(request)) {
+    if(request.id < first || request.id >= first + count || seen[request.id - first]) {
+      fprintf(log_file_stream, "Request %lu completed twice or was never submitted\n", request.id);
+      failed(ssd);
+    }
+    seen[request.id - first] = true;
+    if(request.status != SUCCESS || !ssd -> is_valid(request.logical_address, request.address)) {
+      fprintf(log_file_stream, "Request %lu for LBA %lu failed\n", request.id, request.logical_address);
+      failed(ssd);
+    }
+    if(request.finish_time < request.arrive_time || request.finish_time < last_finish) {
+      fprintf(log_file_stream, "Request %lu finished at %f, arrived at %f, after a completion at %f\n", request.id, request.finish_time, request.arrive_time, last_finish);
+      failed(ssd);
+    }
+    if(request.id < last_id)
+      overtaken++;
+    last_finish = request.finish_time;
+    last_id = request.id;
+    done.push_back(request);
+  }
+  if(done.size() != count) {
+    fprintf(log_file_stream, "%lu of %lu requests completed\n", (unsigned long) done.size(), count);
+    failed(ssd);
+  }
+  return overtaken;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long num_pages = 0;
+  unsigned long first = 0;
+  unsigned long die = 0;
+  unsigned long overtaken = 0;
+  unsigned long i = 0;
+  double time = 0;
+  double read_time = 0;
+  double last_finish = 0;
+  std::map<unsigned long, unsigned long> die_reads;
+  std::map<unsigned long, Request> by_lba;
+  std::vector<Request> done;
+  Request request;
+  unsigned long lba = 0;
+  if(argc != 3) {
+    printf("usage: test_3_15 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  first = ssd -> submit(WRITE, 0, 1, time);
+  for(lba = 1; lba < num_pages; lba++)
+    (void) ssd -> submit(WRITE, lba, 1, time);
+  ssd -> run();
+  (void) drain(ssd, first, num_pages, done);
+  if(ssd -> get_idle_gc_blocks() != 0) {
+    fprintf(log_file_stream, "The drive cleaned without invalid pages\n");
+    failed(ssd);
+  }
+
+  time = ssd -> get_time();
+  first = ssd -> submit(READ, 0, 1, time);
+  for(lba = 1; lba < num_pages; lba++)
+    (void) ssd -> submit(READ, lba, 1, time);
+  ssd -> run();
+  overtaken = drain(ssd, first, num_pages, done);
+  fprintf(log_file_stream, "Reads completed before one submitted earlier: %lu\n", overtaken);
+  if(overtaken == 0) {
+    fprintf(log_file_stream, "The reads completed in submission order\n");
+    failed(ssd);
+  }
+  for(i = 0; i < done.size(); i++)
+    by_lba[done[i].logical_address] = done[i];
+  read_time = by_lba[0].finish_time - by_lba[0].arrive_time;
+  for(lba = 0; lba < num_pages; lba++) {
+    die = by_lba[lba].address.package * PACKAGE_SIZE + by_lba[lba].address.die;
+    if(by_lba[lba].finish_time - by_lba[lba].arrive_time != read_time + die_reads[die] * PAGE_READ_DELAY) {
+      fprintf(log_file_stream, "Read of LBA %lu on die %lu took %f after %lu reads on the die\n", lba, die, by_lba[lba].finish_time - by_lba[lba].arrive_time, die_reads[die]);
+      failed(ssd);
+    }
+    die_reads[die]++;
+  }
+
+  time = ssd -> get_time();
+  first = ssd -> submit(WRITE, 0, 1, time);
+  for(lba = 1; lba < num_pages / 2; lba++)
+    (void) ssd -> submit(WRITE, lba, 1, time);
+  ssd -> run(time);
+  if(ssd -> get_completion(request)) {
+    fprintf(log_file_stream, "A write completed when it arrived\n");
+    failed(ssd);
+  }
+  ssd -> run();
+  (void) drain(ssd, first, num_pages / 2, done);
+  last_finish = done.back().finish_time;
+
+  ssd -> print_latency_histogram(log_file_stream);
+  fprintf(log_file_stream, "Idle cleaning: %lu blocks, %f time, clock %f, last completion %f\n", ssd -> get_idle_gc_blocks(), ssd -> get_idle_gc_time(), ssd -> get_time(), last_finish);
+  if(ssd -> get_idle_gc_blocks() == 0) {
+    fprintf(log_file_stream, "The drive did not clean while idle\n");
+    failed(ssd);
+  }
+  if(ssd -> get_time() < last_finish + GC_IDLE_THRESHOLD + ssd -> get_idle_gc_time()) {
+    fprintf(log_file_stream, "The drive cleaned before it was idle for the threshold\n");
+    failed(ssd);
+  }
+
+  /* a request after the cleaning reads back what was rewritten */
+  time = ssd -> get_time();
+  first = ssd -> submit(READ, 0, 1, time);
+  ssd -> run();
+  (void) drain(ssd, first, 1, done);
+  if(ssd -> get_hidden_gc_time() != ssd -> get_idle_gc_time()) {
+    fprintf(log_file_stream, "Cleaning before any request arrived was not all hidden: %f of %f\n", ssd -> get_hidden_gc_time(), ssd -> get_idle_gc_time());
+    failed(ssd);
+  }
+
+  /* a read as soon as the first step of the next cleaning starts, the
+   * rewrites are checked above and the step may move what they wrote */
+  time = ssd -> get_time();
+  for(lba = 0; lba < num_pages / 2; lba++)
+    (void) ssd -> submit(WRITE, lba, 1, time);
+  ssd -> run(time);
+  i = ssd -> get_idle_gc_blocks();
+  while(ssd -> get_idle_gc_blocks() == i)
+    ssd -> run(ssd -> get_next_time());
+  while(ssd -> get_completion(request))
+    ;
+  time = ssd -> get_time();
+  first = ssd -> submit(READ, 0, 1, time);
+  ssd -> run();
+  (void) drain(ssd, first, 1, done);
+  fprintf(log_file_stream, "Idle cleaning: %f time, %f hidden\n", ssd -> get_idle_gc_time(), ssd -> get_hidden_gc_time());
+  if(ssd -> get_hidden_gc_time() >= ssd -> get_idle_gc_time()) {
+    fprintf(log_file_stream, "The step the read arrived during was counted as hidden\n");
+    failed(ssd);
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
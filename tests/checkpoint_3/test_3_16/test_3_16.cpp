@@ -0,0 +1,192 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Host queues: a page-mapped drive is filled through HOST_NUM_QUEUES queue
+ * pairs kept full, then read at queue depths 1 to HOST_QUEUE_DEPTH on one
+ * queue and on every queue.  A full queue must refuse a submission, every
+ * command must complete once, on the queue it was submitted to, and each
+ * completion queue must be in finish order while reads on different dies
+ * complete out of submission order.  Reads complete faster the deeper the
+ * queues.  Last, reads of one page queue on its die in the order weighted
+ * round robin fetches them: three from a queue of weight three for every one
+ * from a queue of weight one. */
+
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+/* read or write every page with each of the queues kept at depth commands
+ * returns the time taken */
+double replay(Ssd *ssd, unsigned int num_queues, unsigned int depth, enum event_type type, unsigned long num_pages, unsigned long &overtaken) {
+  Host_interface host(*ssd, num_queues, depth);
+  std::map<unsigned long, unsigned long> lba_of;
+  std::vector<unsigned long> last_id(num_queues, 0);
+  std::vector<double> last_finish(num_queues, 0);
+  double start = host.get_time();
+  unsigned long lba = 0;
+  unsigned long done = 0;
+  unsigned long id = 0;
+  unsigned int queue = 0;
+  Request request;
+  overtaken = 0;
+
+  while(done < num_pages) {
+    for(queue = 0; queue < num_queues; queue++) {
+      while(lba < num_pages && host.get_outstanding(queue) < depth) {
+        if(host.submit(queue, type, lba, 1, host.get_time(), id) != SUCCESS) {
+          fprintf(log_file_stream, "Queue %u refused a command with %u outstanding\n", queue, host.get_outstanding(queue));
+          failed(ssd);
+        }
+        lba_of[id] = lba++;
+      }
+      if(host.get_outstanding(queue) == depth && host.submit(queue, type, 0, 1, host.get_time(), id) != FAILURE) {
+        fprintf(log_file_stream, "Queue %u took a command beyond its depth\n", queue);
+        failed(ssd);
+      }
+    }
+    if(!host.step()) {
+      fprintf(log_file_stream, "Nothing left to run with %lu of %lu commands done\n", done, num_pages);
+      failed(ssd);
+    }
+    for(queue = 0; queue < num_queues; queue++) {
+      while(host.get_completion(queue, request)) {
+        if(lba_of.count(request.id) == 0 || lba_of[request.id] != request.logical_address) {
+          fprintf(log_file_stream, "Command %lu completed twice or for the wrong LBA\n", request.id);
+          failed(ssd);
+        }
+        lba_of.erase(request.id);
+        if(request.status != SUCCESS || !ssd -> is_valid(request.logical_address, request.address)) {
+          fprintf(log_file_stream, "Command %lu for LBA %lu failed\n", request.id, request.logical_address);
+          failed(ssd);
+        }
+        if(request.finish_time < request.arrive_time || request.finish_time < last_finish[queue]) {
+          fprintf(log_file_stream, "Command %lu finished at %f, arrived at %f, after a completion at %f\n", request.id, request.finish_time, request.arrive_time, last_finish[queue]);
+          failed(ssd);
+        }
+        if(request.id < last_id[queue])
+          overtaken++;
+        last_finish[queue] = request.finish_time;
+        last_id[queue] = request.id;
+        done++;
+      }
+    }
+  }
+  return host.get_time() - start;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long num_pages = 0;
+  unsigned long overtaken = 0;
+  unsigned long id = 0;
+  unsigned int depth = 0;
+  unsigned int queues = 0;
+  unsigned int queue = 0;
+  unsigned int i = 0;
+  double time = 0;
+  double last_time = 0;
+  std::vector<unsigned int> order;
+  std::map<double, unsigned int> by_finish;
+  Request request;
+  if(argc != 3) {
+    printf("usage: test_3_16 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  time = replay(ssd, HOST_NUM_QUEUES, HOST_QUEUE_DEPTH, WRITE, num_pages, overtaken);
+  fprintf(log_file_stream, "Fill: %lu writes in %f\n", num_pages, time);
+
+  for(queues = 1; queues <= HOST_NUM_QUEUES; queues *= HOST_NUM_QUEUES) {
+    last_time = 0;
+    for(depth = 1; depth <= HOST_QUEUE_DEPTH; depth *= 2) {
+      time = replay(ssd, queues, depth, READ, num_pages, overtaken);
+      fprintf(log_file_stream, "Queues %u, depth %u: %lu reads in %f, %f per unit time, %lu out of order\n", queues, depth, num_pages, time, num_pages / time, overtaken);
+      if(last_time != 0 && time >= last_time) {
+        fprintf(log_file_stream, "Reads were not faster at a deeper queue\n");
+        failed(ssd);
+      }
+      if(depth == HOST_QUEUE_DEPTH && overtaken == 0) {
+        fprintf(log_file_stream, "Reads completed in submission order\n");
+        failed(ssd);
+      }
+      last_time = time;
+    }
+  }
+
+  /* every read of LBA 0 waits for the ones fetched before it */
+  Host_interface host(*ssd, 2, HOST_QUEUE_DEPTH);
+  host.set_weight(0, 3);
+  for(queue = 0; queue < 2; queue++)
+    for(i = 0; i < HOST_QUEUE_DEPTH; i++)
+      if(host.submit(queue, READ, 0, 1, host.get_time(), id) != SUCCESS) {
+        fprintf(log_file_stream, "Queue %u refused a command\n", queue);
+        failed(ssd);
+      }
+  host.run();
+  for(queue = 0; queue < 2; queue++)
+    while(host.get_completion(queue, request))
+      by_finish[request.finish_time] = queue;
+  if(by_finish.size() != 2 * HOST_QUEUE_DEPTH) {
+    fprintf(log_file_stream, "Reads of one page did not finish one after the other\n");
+    failed(ssd);
+  }
+  for(queue = 0; order.size() < 2 * HOST_QUEUE_DEPTH; queue = 1 - queue)
+    for(i = 0; i < (queue == 0 ? 3u : 1u); i++)
+      if((unsigned int) std::count(order.begin(), order.end(), queue) < HOST_QUEUE_DEPTH)
+        order.push_back(queue);
+  i = 0;
+  for(std::map<double, unsigned int>::iterator it = by_finish.begin(); it != by_finish.end(); it++, i++) {
+    fprintf(log_file_stream, "Read %u of LBA 0 came from queue %u\n", i, it -> second);
+    if(it -> second != order[i]) {
+      fprintf(log_file_stream, "Expected queue %u\n", order[i]);
+      failed(ssd);
+    }
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
@@ -0,0 +1,155 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Channel use of a read to a busy die: a page-mapped drive with page reads
+ * much longer than bus transfers is filled, then a page is read from a die.
+ * While that die is busy, a second read to it and a read to another die of
+ * the same package arrive together, and later a third die of the package is
+ * read.  A read sends only its command before the die reads the page and its
+ * data after, so the read to the busy die must not hold the channel while it
+ * waits: the read to the other die waits for one command transfer and no
+ * more, the third die does not wait at all, and the second read to the busy
+ * die finishes exactly one page read after the first one. */
+
+#include <string.h>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+/* read lba at time, returns the time taken */
+double read(Ssd *ssd, unsigned long lba, double time, double &bus_wait) {
+  int ret_status;
+  Address address;
+  double time_taken = ssd -> event_arrive(READ, lba, 1, time, &ret_status, address);
+  if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+    fprintf(log_file_stream, "Error reading LBA %lu\n", lba);
+    failed(ssd);
+  }
+  bus_wait = ssd->get_last_bus_wait_time();
+  fprintf(log_file_stream, "Read of LBA %lu at %f took %f, waited %f for the bus\n", lba, time, time_taken, bus_wait);
+  return time_taken;
+}
+
+int main(int argc, char *argv[])
+{
+  int ret_status;
+  unsigned long num_pages = 0;
+  unsigned long busy = 0;
+  unsigned long other = 0;
+  unsigned long third = 0;
+  unsigned long lba = 0;
+  unsigned int busy_die = 0;
+  unsigned int other_die = 0;
+  double time = 0;
+  double read_time = 0;
+  double die_time = 0;
+  double first = 0;
+  double second = 0;
+  double bus_wait = 0;
+  double time_taken = 0;
+  Address address;
+  if(argc != 3) {
+    printf("usage: test_3_17 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  /* pick a second page on the die of LBA 0 and pages on two other dies of
+   * its package */
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error writing LBA %lu\n", lba);
+      failed(ssd);
+    }
+    if(lba == 0)
+      busy_die = address.die;
+    else if(address.package == 0 && address.die == busy_die && busy == 0)
+      busy = lba;
+    else if(address.package == 0 && address.die != busy_die && other == 0) {
+      other = lba;
+      other_die = address.die;
+    }
+    else if(address.package == 0 && address.die != busy_die && address.die != other_die && other != 0 && third == 0)
+      third = lba;
+  }
+  if(busy == 0 || other == 0 || third == 0) {
+    fprintf(log_file_stream, "Package 0 does not have the pages to read\n");
+    failed(ssd);
+  }
+
+  /* an uncontended read, and the part of it spent on the die */
+  time += 1000;
+  read_time = read(ssd, 0, time, bus_wait);
+  die_time = read_time - BUS_CTRL_DELAY - BUS_DATA_DELAY - RAM_WRITE_DELAY - RAM_READ_DELAY;
+  if(bus_wait != 0 || die_time < PAGE_READ_DELAY) {
+    fprintf(log_file_stream, "An uncontended read waited for the bus or took less than a page read\n");
+    failed(ssd);
+  }
+
+  time += 1000;
+  first = time + read(ssd, 0, time, bus_wait);
+  second = time + 20 + read(ssd, busy, time + 20, bus_wait);
+  if(bus_wait != 0) {
+    fprintf(log_file_stream, "The read to the busy die waited %f for the bus\n", bus_wait);
+    failed(ssd);
+  }
+  if(second != first + PAGE_READ_DELAY) {
+    fprintf(log_file_stream, "The read to the busy die finished at %f, not one page read after %f\n", second, first);
+    failed(ssd);
+  }
+
+  time_taken = read(ssd, other, time + 20, bus_wait);
+  if(bus_wait != BUS_CTRL_DELAY || time_taken != read_time + BUS_CTRL_DELAY) {
+    fprintf(log_file_stream, "The read to another die waited for the read to the busy die\n");
+    failed(ssd);
+  }
+
+  time_taken = read(ssd, third, time + 50, bus_wait);
+  if(bus_wait != 0 || time_taken != read_time) {
+    fprintf(log_file_stream, "The channel was held while a read waited for its die\n");
+    failed(ssd);
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
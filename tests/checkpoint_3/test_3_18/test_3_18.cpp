@@ -0,0 +1,148 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Copyback relocation: a page-mapped drive whose data transfers and RAM
+ * reads take far longer than a whole block of flash operations is filled and
+ * then overwritten at random.  After every write that cleaned, each page is
+ * read back and the pages that moved are counted by where they went.  Every
+ * move must be a MERGE that stays in its die, within its plane and across
+ * planes both must happen, and a write that cleaned must take less than one
+ * data transfer longer than a write that did not, so that no relocated page
+ * crossed the channel or went through RAM. */
+
+#include <string.h>
+#include <vector>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+/* read or write lba at time and check it, returns the time taken */
+double access(Ssd *ssd, enum event_type type, unsigned long lba, double time, Address &address) {
+  int ret_status;
+  double time_taken = ssd -> event_arrive(type, lba, 1, time, &ret_status, address);
+  if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+    fprintf(log_file_stream, "Error %s LBA %lu\n", type == READ ? "reading" : "writing", lba);
+    failed(ssd);
+  }
+  if(ssd->get_last_bus_wait_time() != 0) {
+    fprintf(log_file_stream, "Access to LBA %lu waited %f for the bus\n", lba, ssd->get_last_bus_wait_time());
+    failed(ssd);
+  }
+  return time_taken;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long num_pages = 0;
+  unsigned long lba = 0;
+  unsigned long i = 0;
+  unsigned long merges = 0;
+  unsigned long erases = 0;
+  unsigned long moved = 0;
+  unsigned long same_plane = 0;
+  unsigned long cross_plane = 0;
+  double time = 0;
+  double time_taken = 0;
+  double write_time = 0;
+  std::vector<Address> location;
+  Address address;
+  if(argc != 3) {
+    printf("usage: test_3_18 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+  location.resize(num_pages);
+
+  for(lba = 0; lba < num_pages; lba++)
+    time += access(ssd, WRITE, lba, time, location[lba]);
+
+  srand(1);
+  for(i = 0; i < 8 * num_pages && (same_plane == 0 || cross_plane == 0); i++) {
+    lba = rand() % num_pages;
+    time_taken = access(ssd, WRITE, lba, time, location[lba]);
+    time += time_taken;
+    if(ssd -> get_total_merges_performed() == merges) {
+      if(ssd -> get_total_erases_performed() == erases)
+        write_time = time_taken;
+      erases = ssd -> get_total_erases_performed();
+      continue;
+    }
+
+    fprintf(log_file_stream, "Write %lu of LBA %lu took %f with %lu merges, %f without cleaning\n", i, lba, time_taken, ssd -> get_total_merges_performed() - merges, write_time);
+    if(write_time == 0 || time_taken - write_time >= BUS_DATA_DELAY || time_taken - write_time >= RAM_READ_DELAY) {
+      fprintf(log_file_stream, "Cleaning moved data over the channel or through RAM\n");
+      failed(ssd);
+    }
+
+    moved = 0;
+    for(lba = 0; lba < num_pages; lba++) {
+      time += access(ssd, READ, lba, time, address);
+      if(address == location[lba])
+        continue;
+      moved++;
+      if(address.package != location[lba].package || address.die != location[lba].die) {
+        fprintf(log_file_stream, "LBA %lu moved to another die\n", lba);
+        failed(ssd);
+      }
+      else if(address.plane == location[lba].plane)
+        same_plane++;
+      else
+        cross_plane++;
+      location[lba] = address;
+    }
+    if(moved != ssd -> get_total_merges_performed() - merges) {
+      fprintf(log_file_stream, "%lu pages moved with %lu merges\n", moved, ssd -> get_total_merges_performed() - merges);
+      failed(ssd);
+    }
+    merges = ssd -> get_total_merges_performed();
+    erases = ssd -> get_total_erases_performed();
+  }
+
+  fprintf(log_file_stream, "Copybacks within a plane: %lu, across planes: %lu, in %lu writes\n", same_plane, cross_plane, i);
+  if(same_plane == 0 || cross_plane == 0) {
+    fprintf(log_file_stream, "Cleaning did not copy back both within and across planes\n");
+    failed(ssd);
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
@@ -0,0 +1,125 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Concurrent merges: a hybrid drive is filled and overwritten at random until
+ * its log blocks run out, then left idle to clean up to GC_IDLE_WATERMARK.
+ * This is done with 1, 2 and 4 packages and a cleaning block for every die.
+ * Background cleaning merges victims on different dies at the same time, so
+ * the time it takes per log block freed must drop as the drive gets more
+ * dies, and every page must still read back. */
+
+#include <string.h>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+/* read or write lba at time and check it, returns the time taken */
+double access(Ssd *ssd, enum event_type type, unsigned long lba, double time) {
+  int ret_status;
+  Address address;
+  double time_taken = ssd -> event_arrive(type, lba, 1, time, &ret_status, address);
+  if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+    fprintf(log_file_stream, "Error %s LBA %lu\n", type == READ ? "reading" : "writing", lba);
+    failed(ssd);
+  }
+  return time_taken;
+}
+
+/* run the workload on a drive of num_packages packages
+ * returns the idle cleaning time per log block freed */
+double reclaim(unsigned int num_packages) {
+  char ssd_size[] = "SSD_SIZE";
+  char cleaning_blocks[] = "CLEANING_BLOCKS";
+  unsigned long num_pages = 0;
+  unsigned long lba = 0;
+  unsigned long i = 0;
+  double time = 0;
+  double per_block = 0;
+
+  load_entry(ssd_size, num_packages, 0);
+  load_entry(cleaning_blocks, num_packages * PACKAGE_SIZE, 0);
+  init_geometry();
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  for(lba = 0; lba < num_pages; lba++)
+    time += access(ssd, WRITE, lba, time);
+  srand(1);
+  for(i = 0; i < num_pages / 2; i++)
+    time += access(ssd, WRITE, rand() % num_pages, time);
+
+  /* the read arrives long after the cleaning is done */
+  time += 1000 * GC_IDLE_THRESHOLD;
+  time += access(ssd, READ, 0, time);
+  if(ssd -> get_idle_gc_blocks() == 0) {
+    fprintf(log_file_stream, "No log block was freed while idle\n");
+    failed(ssd);
+  }
+  per_block = ssd -> get_idle_gc_time() / ssd -> get_idle_gc_blocks();
+  fprintf(log_file_stream, "%u packages: %lu log blocks freed in %f, %f per log block\n",
+      num_packages, ssd -> get_idle_gc_blocks(), ssd -> get_idle_gc_time(), per_block);
+
+  for(lba = 0; lba < num_pages; lba++)
+    time += access(ssd, READ, lba, time);
+  delete ssd;
+  return per_block;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned int num_packages = 0;
+  double per_block = 0;
+  double last_per_block = 0;
+  if(argc != 3) {
+    printf("usage: test_3_19 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  for(num_packages = 1; num_packages <= 4; num_packages *= 2) {
+    per_block = reclaim(num_packages);
+    if(last_per_block != 0 && per_block >= last_per_block) {
+      fprintf(log_file_stream, "Freeing a log block did not get faster with %u packages\n", num_packages);
+      failed(NULL);
+    }
+    last_per_block = per_block;
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
@@ -0,0 +1,161 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Bus channel stress: short control transfers and long data transfers are
+ * interleaved on one channel the way the controller issues them, with reads
+ * sending their data some time after their command so the channel is left
+ * with short gaps ahead of the current time.  Every lock must land in the
+ * earliest gap long enough for it, as found by a linear scan over all busy
+ * intervals, and unlocking must drop the intervals that have finished.  The
+ * search for a gap steps over each too-short gap after the start time, so
+ * under this load a lock must only ever step over a few of them.  A comb of
+ * short transfers with gaps too short for a data transfer is then laid down,
+ * and data transfers must skip the whole comb. */
+
+#include <string.h>
+#include <vector>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(void) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  exit(EXIT_FAILURE);
+}
+
+/* busy intervals of the reference model, sorted by start time */
+std::vector<std::pair<double, double> > model;
+
+/* earliest time at or after start_time that the model fits duration
+ * skipped counts the gaps after start_time that were too short */
+double model_fit(double start_time, double duration, unsigned int &skipped) {
+  double sched_time = start_time;
+  skipped = 0;
+  for(unsigned int i = 0; i < model.size(); i++) {
+    if(model[i].second <= sched_time)
+      continue;
+    if(model[i].first - sched_time >= duration)
+      break;
+    if(model[i].first > sched_time)
+      skipped++;
+    sched_time = model[i].second;
+  }
+  return sched_time;
+}
+
+/* lock the channel and the model and check they agree, returns the
+ * scheduled time */
+double lock(Channel &channel, double start_time, double duration, unsigned int &max_skipped) {
+  unsigned int skipped = 0;
+  double sched_time = model_fit(start_time, duration, skipped);
+  Event event(WRITE, 0, 1, start_time);
+  if(channel.lock(start_time, duration, event) == FAILURE) {
+    fprintf(log_file_stream, "Lock failed at %f\n", start_time);
+    failed();
+  }
+  if(event.get_bus_wait_time() != sched_time - start_time || event.get_time_taken() != sched_time - start_time + duration) {
+    fprintf(log_file_stream, "Lock of %f at %f scheduled at %f, expected %f\n",
+        duration, start_time, start_time + event.get_bus_wait_time(), sched_time);
+    failed();
+  }
+  std::vector<std::pair<double, double> >::iterator it = model.begin();
+  while(it != model.end() && it -> first < sched_time)
+    it++;
+  model.insert(it, std::make_pair(sched_time, sched_time + duration));
+  if(skipped > max_skipped)
+    max_skipped = skipped;
+  return sched_time;
+}
+
+void unlock(Channel &channel, double time) {
+  channel.unlock(time);
+  std::vector<std::pair<double, double> >::iterator it = model.begin();
+  while(it != model.end())
+    if(it -> second <= time)
+      it = model.erase(it);
+    else
+      it++;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned int num_locks = 200000;
+  unsigned int comb_size = 1000;
+  unsigned int max_skipped = 0;
+  unsigned int i = 0;
+  double time = 0;
+  double sched_time = 0;
+  if(argc != 3) {
+    printf("usage: test_3_20 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+  print_config(log_file_stream);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  /* delays are whole numbers in the config so the times compare exactly */
+  Channel channel(BUS_CTRL_DELAY, BUS_DATA_DELAY, BUS_MAX_CONNECT);
+  srand(1);
+  for(i = 0; i < num_locks; i++) {
+    time += rand() % 32;
+    unlock(channel, time);
+    if(rand() % 2)
+      lock(channel, time, BUS_CTRL_DELAY + BUS_DATA_DELAY, max_skipped);
+    else {
+      lock(channel, time, BUS_CTRL_DELAY, max_skipped);
+      lock(channel, time + BUS_CTRL_DELAY + PAGE_READ_DELAY + rand() % 8, BUS_DATA_DELAY, max_skipped);
+    }
+  }
+  fprintf(log_file_stream, "%u interleaved requests: at most %u short gaps skipped by a lock\n", num_locks, max_skipped);
+  if(max_skipped > 4) {
+    fprintf(log_file_stream, "Locks stepped over too many short gaps\n");
+    failed();
+  }
+
+  /* a comb of control transfers with gaps too short for a data transfer */
+  time += 1000;
+  unlock(channel, time);
+  if(!model.empty()) {
+    fprintf(log_file_stream, "%lu intervals left after unlocking past all of them\n", (unsigned long) model.size());
+    failed();
+  }
+  for(i = 0; i < comb_size; i++)
+    lock(channel, time + i * (BUS_CTRL_DELAY + 1), BUS_CTRL_DELAY, max_skipped);
+  for(i = 0; i < comb_size; i++) {
+    sched_time = lock(channel, time, BUS_DATA_DELAY, max_skipped);
+    if(sched_time < time + comb_size * (BUS_CTRL_DELAY + 1) - 1) {
+      fprintf(log_file_stream, "Data transfer scheduled inside the comb at %f\n", sched_time);
+      failed();
+    }
+  }
+  fprintf(log_file_stream, "Comb of %u control transfers skipped by %u data transfers\n", comb_size, comb_size);
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
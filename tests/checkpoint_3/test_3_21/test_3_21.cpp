@@ -0,0 +1,133 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Heat decay: on a page-mapped drive with write streams and a single plane,
+ * one page is rewritten until its update count saturates, which makes it
+ * hot.  The host then writes other pages for a little more than 257 periods
+ * (a period is half the logical pages written) since the page was last
+ * written or relocated by cleaning, after which the page must be cold again,
+ * as if its count had decayed all along, and not wrapped around to look a
+ * period or two old.  A page is cold when it is written right
+ * after a page that was never written before, in the next page of the same
+ * block of the cold stream. */
+
+#include <string.h>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+/* write lba at time and check it, returns the time taken */
+double write(Ssd *ssd, unsigned long lba, double time, Address &address) {
+  int ret_status;
+  double time_taken = ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+  if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+    fprintf(log_file_stream, "Error writing LBA %lu\n", lba);
+    failed(ssd);
+  }
+  return time_taken;
+}
+
+/* write lba right after the next never written page cold_lba in the cold
+ * stream, returns whether lba was written to the cold stream too */
+bool is_cold(Ssd *ssd, unsigned long lba, unsigned long &cold_lba, double &time) {
+  Address cold_address;
+  Address address;
+  do
+    time += write(ssd, cold_lba++, time, cold_address);
+  while(cold_address.page == BLOCK_SIZE - 1);
+  time += write(ssd, lba, time, address);
+  return address.compare(cold_address) >= BLOCK && address.page == cold_address.page + 1;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long i = 0;
+  unsigned long num_pages = 0;
+  unsigned long period = 0;
+  unsigned long hot_lba = 0;
+  unsigned long cold_lba = 0;
+  unsigned long moved = 0;
+  int ret_status;
+  double time = 0;
+  Address address;
+  Address hot_address;
+  if(argc != 3) {
+    printf("usage: test_3_21 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+  period = num_pages / 2;
+
+  /* the other pages are rewritten in the first quarter of the drive and the
+   * never written pages are taken from the second half */
+  hot_lba = num_pages - 1;
+  cold_lba = num_pages / 2;
+
+  for(i = 0; i < 0x100; i++)
+    time += write(ssd, hot_lba, time, address);
+  if(is_cold(ssd, hot_lba, cold_lba, time)) {
+    fprintf(log_file_stream, "LBA %lu is cold after being rewritten %lu times\n", hot_lba, i);
+    failed(ssd);
+  }
+
+  /* cleaning brings the count up to date when it relocates the page, so
+   * the periods are counted from the last time the page moved */
+  srand(1);
+  time += ssd -> event_arrive(READ, hot_lba, 1, time, &ret_status, hot_address);
+  for(i = 0; i - moved < 257 * period + period / 2; i++) {
+    time += write(ssd, rand() % (num_pages / 4), time, address);
+    if(!ssd->is_valid(hot_lba, hot_address)) {
+      time += ssd -> event_arrive(READ, hot_lba, 1, time, &ret_status, hot_address);
+      moved = i;
+      fprintf(log_file_stream, "LBA %lu moved after %lu writes\n", hot_lba, i);
+    }
+  }
+  fprintf(log_file_stream, "Skipped %lu periods of %lu writes since LBA %lu last moved\n", (i - moved) / period, period, hot_lba);
+
+  if(!is_cold(ssd, hot_lba, cold_lba, time)) {
+    fprintf(log_file_stream, "LBA %lu is still hot after %lu periods\n", hot_lba, (i - moved) / period);
+    failed(ssd);
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
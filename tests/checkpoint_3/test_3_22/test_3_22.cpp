@@ -0,0 +1,253 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Dynamic wear leveling: blocks are erased a random number of times through
+ * a controller of their own, then
+ * - the write frontier of a plane is moved across all of its blocks, and each
+ *   block it moves on to must be the free block with the most erases
+ *   remaining, as must the block get_free_block hands out before it;
+ * - the free log blocks of the hybrid FTL are put back in its pool, and each
+ *   block taken from the pool must have the most erases remaining of the
+ *   blocks still in it.
+ * Handing out the least worn free block does not keep the most worn block
+ * close to the mean by itself, since the blocks of cold data are never freed.
+ * That takes static wear leveling as well: a hybrid drive is filled, then
+ * only a tenth of it is rewritten with idle periods between the writes, and
+ * the most worn block must stay within twice WL_THRESHOLD erases of the mean.
+ * Without WL_THRESHOLD the hot blocks of this drive wear out. */
+
+#include <string.h>
+#include <vector>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+/* issue an event for address at time and check it, returns the time taken */
+double issue(Ssd *ssd, Controller &controller, enum event_type type, const Address &address, double time) {
+  Event event(type, 0, 1, time);
+  event.set_address(address);
+  if(controller.issue(event) == FAILURE) {
+    fprintf(log_file_stream, "Error issuing event to block %u of plane %u\n", address.block, address.plane);
+    failed(ssd);
+  }
+  return event.get_time_taken();
+}
+
+/* write the first page of the block given by address and erase it, times
+ * times over */
+void wear_block(Ssd *ssd, Controller &controller, Address address, unsigned int times, double &time) {
+  unsigned int i = 0;
+  for(i = 0; i < times; i++) {
+    address.page = 0;
+    address.valid = PAGE;
+    time += issue(ssd, controller, WRITE, address, time);
+    address.valid = BLOCK;
+    time += issue(ssd, controller, ERASE, address, time);
+  }
+}
+
+/* move the write frontier of the first plane across all of its blocks */
+void check_plane(void) {
+  Ssd *ssd = new Ssd(log_file_stream);
+  Controller controller(*ssd, log_file_stream);
+  Ftl ftl(controller, log_file_stream);
+  std::vector<bool> taken(PLANE_SIZE, false);
+  Address plane(0, 0, 0, 0, 0, PLANE);
+  Address address;
+  Address free_block;
+  unsigned long most_remaining = 0;
+  unsigned int block = 0;
+  unsigned int i = 0;
+  double time = 0;
+
+  /* the first frontier block was taken before any block was worn */
+  address = plane;
+  ftl.get_free_page(address);
+  taken[address.block] = true;
+
+  srand(1);
+  for(block = 0; block < PLANE_SIZE; block++) {
+    address = plane;
+    address.block = block;
+    wear_block(ssd, controller, address, rand() % 8, time);
+  }
+
+  for(i = 1; i < PLANE_SIZE; i++) {
+    most_remaining = 0;
+    for(block = 0; block < PLANE_SIZE; block++) {
+      address = plane;
+      address.block = block;
+      address.valid = BLOCK;
+      if(!taken[block] && ftl.get_erases_remaining(address) > most_remaining)
+        most_remaining = ftl.get_erases_remaining(address);
+    }
+
+    free_block = plane;
+    ftl.get_free_block(free_block);
+    free_block.valid = BLOCK;
+    if(free_block.block >= PLANE_SIZE || taken[free_block.block] || ftl.get_erases_remaining(free_block) != most_remaining) {
+      fprintf(log_file_stream, "Free block %u handed out with %lu erases remaining, %lu expected\n",
+          free_block.block, ftl.get_erases_remaining(free_block), most_remaining);
+      failed(ssd);
+    }
+
+    /* fill the frontier block so that the frontier moves on */
+    address = plane;
+    ftl.get_free_page(address);
+    block = address.block;
+    while(address.valid == PAGE && address.block == block) {
+      time += issue(ssd, controller, WRITE, address, time);
+      address = plane;
+      ftl.get_free_page(address);
+    }
+    address.valid = BLOCK;
+    fprintf(log_file_stream, "Frontier moved from block %u to block %u with %lu erases remaining\n",
+        block, address.block, ftl.get_erases_remaining(address));
+    if(address.block != free_block.block) {
+      fprintf(log_file_stream, "Frontier moved to block %u instead of free block %u\n", address.block, free_block.block);
+      failed(ssd);
+    }
+    taken[address.block] = true;
+  }
+  delete ssd;
+}
+
+/* take every log block out of the free pool of the hybrid FTL, wear them and
+ * put them back */
+void check_pool(void) {
+  Ssd *ssd = new Ssd(log_file_stream);
+  Controller controller(*ssd, log_file_stream);
+  Ftl ftl(controller, log_file_stream);
+  std::vector<LOG_BLOCK*> free_log_blocks;
+  std::multimap<unsigned long, LOG_BLOCK*, std::greater<unsigned long> >::iterator it;
+  LOG_BLOCK *log_block = NULL;
+  unsigned long most_remaining = 0;
+  unsigned long erases_remaining = 0;
+  unsigned long i = 0;
+  double time = 0;
+
+  while(!ftl.free_log_blocks.empty())
+    free_log_blocks.push_back(ftl.wear.get_free_log_block());
+  srand(2);
+  for(i = 0; i < free_log_blocks.size(); i++)
+    wear_block(ssd, controller, free_log_blocks[i] -> block.get_address(), rand() % 8, time);
+  for(i = free_log_blocks.size(); i > 0; i--)
+    ftl.wear.add_free_log_block(free_log_blocks[i - 1]);
+
+  for(i = 0; i < free_log_blocks.size(); i++) {
+    most_remaining = 0;
+    for(it = ftl.free_log_blocks.begin(); it != ftl.free_log_blocks.end(); it++)
+      if(ftl.get_erases_remaining(it -> second -> block.get_address()) > most_remaining)
+        most_remaining = ftl.get_erases_remaining(it -> second -> block.get_address());
+    log_block = ftl.wear.get_free_log_block();
+    erases_remaining = ftl.get_erases_remaining(log_block -> block.get_address());
+    if(erases_remaining != most_remaining) {
+      fprintf(log_file_stream, "Free log block %lu handed out with %lu erases remaining, %lu expected\n",
+          log_block -> number, erases_remaining, most_remaining);
+      failed(ssd);
+    }
+  }
+  fprintf(log_file_stream, "%lu free log blocks handed out least worn first\n", (unsigned long) free_log_blocks.size());
+  delete ssd;
+}
+
+/* rewrite a tenth of a hybrid drive and check the spread of the erases */
+void check_spread(void) {
+  int ret_status;
+  unsigned long i = 0;
+  unsigned long num_pages = 0;
+  double time = 0;
+  double mean_erases = 0;
+  unsigned long lba = 0;
+  Address address;
+  Ssd *ssd = new Ssd(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error writing LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  srand(1);
+  for(i = 0; i < 4 * num_pages; i++) {
+    lba = rand() % (num_pages / 10);
+    time += ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error rewriting LBA %lu\n", lba);
+      failed(ssd);
+    }
+    time += 2 * GC_IDLE_THRESHOLD;
+  }
+
+  mean_erases = (double) ssd->get_total_erases_performed() / (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE);
+  fprintf(log_file_stream, "Erases performed: %lu\n", ssd->get_total_erases_performed());
+  fprintf(log_file_stream, "Mean erases: %f\n", mean_erases);
+  fprintf(log_file_stream, "Max erases: %lu\n", ssd->get_max_num_erases());
+  if(ssd->get_max_num_erases() > mean_erases + 2 * WL_THRESHOLD) {
+    fprintf(log_file_stream, "The most worn block is too far above the mean\n");
+    failed(ssd);
+  }
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(READ, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error reading LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+  delete ssd;
+}
+
+int main(int argc, char *argv[])
+{
+  if(argc != 3) {
+    printf("usage: test_3_22 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  print_config(log_file_stream);
+  check_plane();
+  check_pool();
+  check_spread();
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
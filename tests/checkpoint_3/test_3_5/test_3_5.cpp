@@ -0,0 +1,149 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Page-mapped FTL with each cleaning policy in turn: the same random
+ * overwrite workload as test_3_1 on a new drive, then check the write
+ * amplification the drive reports and that every cleaned block shows up in
+ * the per-block erase counts.  The write amplification of every policy is
+ * logged, and under uniform random overwrites the greedy policy must not
+ * copy more than FIFO or LRU. */
+
+#include <string.h>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+/* run the workload on a new drive cleaning with policy
+ * returns the write amplification */
+double run_policy(enum GC_POLICY policy) {
+  int ret_status;
+  unsigned long i = 0;
+  unsigned long num_pages = 0;
+  unsigned long time = 0;
+  unsigned long lba = 0;
+  unsigned long erases = 0;
+  double write_amplification = 0;
+  Address address;
+
+  SELECTED_GC_POLICY = policy;
+  Ssd *ssd = new Ssd(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  for(lba = 0; lba < num_pages; lba++) {
+    ssd -> event_arrive(WRITE, lba, 1, (++time), &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error writing LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  ssd -> event_arrive(WRITE, num_pages, 1, (++time), &ret_status, address);
+  if(ret_status != FAILURE) {
+    fprintf(log_file_stream, "Wrote LBA %lu in the overprovisioned space\n", num_pages);
+    failed(ssd);
+  }
+
+  srand(1);
+  for(i = 0; i < 4 * num_pages; i++) {
+    lba = rand() % num_pages;
+    ssd -> event_arrive(WRITE, lba, 1, (++time), &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error rewriting LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  if(ssd->get_total_erases_performed() == 0) {
+    fprintf(log_file_stream, "No blocks were cleaned\n");
+    failed(ssd);
+  }
+  write_amplification = ssd->get_write_amplification();
+  fprintf(log_file_stream, "Policy %d: erases performed: %lu\n", policy, ssd->get_total_erases_performed());
+  fprintf(log_file_stream, "Policy %d: host writes: %lu\n", policy, ssd->get_total_host_writes());
+  fprintf(log_file_stream, "Policy %d: write amplification: %f\n", policy, write_amplification);
+  if(write_amplification < 1.0) {
+    fprintf(log_file_stream, "Write amplification is below 1\n");
+    failed(ssd);
+  }
+
+  erases = 0;
+  address.valid = BLOCK;
+  for(address.package = 0; address.package < SSD_SIZE; address.package++)
+    for(address.die = 0; address.die < PACKAGE_SIZE; address.die++)
+      for(address.plane = 0; address.plane < DIE_SIZE; address.plane++)
+        for(address.block = 0; address.block < PLANE_SIZE; address.block++)
+          erases += ssd->get_block_erase_count(address);
+  if(erases != ssd->get_total_erases_performed()) {
+    fprintf(log_file_stream, "Block erase counts add up to %lu\n", erases);
+    failed(ssd);
+  }
+
+  for(lba = 0; lba < num_pages; lba++) {
+    ssd -> event_arrive(READ, lba, 1, (++time), &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error reading LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+  delete ssd;
+  return write_amplification;
+}
+
+int main(int argc, char *argv[])
+{
+  double write_amplification[COST_BENEFIT + 1];
+  int policy;
+  if(argc != 3) {
+    printf("usage: test_3_5 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  print_config(log_file_stream);
+  for(policy = FIFO; policy <= COST_BENEFIT; policy++)
+    write_amplification[policy] = run_policy((enum GC_POLICY) policy);
+
+  fprintf(log_file_stream, "Write amplification: FIFO %f, LRU %f, GREEDY %f, COST_BENEFIT %f\n",
+      write_amplification[FIFO], write_amplification[LRU], write_amplification[GREEDY], write_amplification[COST_BENEFIT]);
+  if(write_amplification[GREEDY] > write_amplification[FIFO] || write_amplification[GREEDY] > write_amplification[LRU]) {
+    fprintf(log_file_stream, "The greedy policy copied more than FIFO or LRU\n");
+    failed(NULL);
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
@@ -0,0 +1,123 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Background cleaning: overwrite random pages of a full page-mapped drive in
+ * bursts separated by idle periods longer than GC_IDLE_THRESHOLD.  Blocks
+ * have to be cleaned in the idle periods, that time must not be charged to
+ * the requests, and every page must still read back from the address of its
+ * last write. */
+
+#include <string.h>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  int ret_status;
+  unsigned long i = 0;
+  unsigned long num_pages = 0;
+  unsigned long stalls = 0;
+  double time = 0;
+  double time_taken = 0;
+  unsigned long lba = 0;
+  Address address;
+  if(argc != 3) {
+    printf("usage: test_3_6 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  /* back to back requests leave the drive no idle time */
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error writing LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+  if(ssd->get_idle_gc_blocks() != 0) {
+    fprintf(log_file_stream, "Cleaned without idle time\n");
+    failed(ssd);
+  }
+
+  srand(1);
+  for(i = 0; i < 4 * num_pages; i++) {
+    /* bursts of 64 writes with an idle period after each */
+    if(i % 64 == 0)
+      time += 100 * GC_IDLE_THRESHOLD;
+    lba = rand() % num_pages;
+    time_taken = ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error rewriting LBA %lu\n", lba);
+      failed(ssd);
+    }
+    if(time_taken >= BLOCK_ERASE_DELAY)
+      stalls++;
+    time += time_taken;
+  }
+
+  fprintf(log_file_stream, "Erases performed: %lu\n", ssd->get_total_erases_performed());
+  fprintf(log_file_stream, "Blocks cleaned in the background: %lu\n", ssd->get_idle_gc_blocks());
+  fprintf(log_file_stream, "Background cleaning time: %f\n", ssd->get_idle_gc_time());
+  fprintf(log_file_stream, "Hidden in idle time: %f\n", ssd->get_hidden_gc_time());
+  fprintf(log_file_stream, "Writes stalled by cleaning: %lu\n", stalls);
+  if(ssd->get_idle_gc_blocks() == 0) {
+    fprintf(log_file_stream, "No blocks were cleaned in the background\n");
+    failed(ssd);
+  }
+  if(ssd->get_hidden_gc_time() <= 0 || ssd->get_hidden_gc_time() > ssd->get_idle_gc_time()) {
+    fprintf(log_file_stream, "Background cleaning time was not hidden\n");
+    failed(ssd);
+  }
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(READ, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error reading LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
@@ -0,0 +1,118 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_test.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Incremental cleaning in the page-mapped FTL: overwrite runs of 8 pages at
+ * random places of a full drive back to back.  Each write may copy
+ * GC_STEP_PAGES pages or erase a block, so unless the drive runs out of free
+ * blocks no write may take longer than that.  Every page must still read
+ * back from the address of its last write. */
+
+#include <string.h>
+#include "ssd.h"
+
+using namespace ssd;
+FILE *log_file_stream;
+char log_file_path[255];
+
+void failed(Ssd *ssd) {
+  printf("FAILED ...Check %s for more details.\n", log_file_path);
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  int ret_status;
+  unsigned long i = 0;
+  unsigned long num_pages = 0;
+  unsigned long stalls = 0;
+  double time = 0;
+  double time_taken = 0;
+  double step_bound = 0;
+  unsigned long lba = 0;
+  Address address;
+  if(argc != 3) {
+    printf("usage: test_3_7 <config_file_name> <log_file_path>\n");
+    exit(EXIT_FAILURE);
+  }
+
+  strcpy(log_file_path, argv[2]);
+  log_file_stream = fopen(log_file_path, "w+");
+  load_config(argv[1]);
+
+	fprintf(log_file_stream, "------------------------------------------------------------\n");
+
+  Ssd *ssd = new Ssd(log_file_stream);
+  print_config(log_file_stream);
+  num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+      (unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error writing LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  /* a write copying more than GC_STEP_PAGES pages for cleaning took the
+   * blocking fallback */
+  step_bound = (GC_STEP_PAGES + 1) * (PAGE_READ_DELAY + PAGE_WRITE_DELAY + 2 * (RAM_READ_DELAY + RAM_WRITE_DELAY)
+      + 2 * (BUS_CTRL_DELAY + BUS_DATA_DELAY)) + BLOCK_ERASE_DELAY + BUS_CTRL_DELAY;
+  srand(1);
+  for(i = 0; i < 4 * num_pages; i++) {
+    lba = (i % 8 == 0) ? rand() % num_pages : (lba + 1) % num_pages;
+    time_taken = ssd -> event_arrive(WRITE, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error rewriting LBA %lu\n", lba);
+      failed(ssd);
+    }
+    if(time_taken > step_bound)
+      stalls++;
+    time += time_taken;
+  }
+
+  ssd->print_latency_histogram(log_file_stream);
+  fprintf(log_file_stream, "Erases performed: %lu\n", ssd->get_total_erases_performed());
+  fprintf(log_file_stream, "Writes over the step bound %f: %lu\n", step_bound, stalls);
+  if(ssd->get_total_erases_performed() == 0) {
+    fprintf(log_file_stream, "No blocks were cleaned\n");
+    failed(ssd);
+  }
+  if(stalls > 4 * num_pages / 1000) {
+    fprintf(log_file_stream, "Too many writes fell back to blocking cleaning\n");
+    failed(ssd);
+  }
+
+  for(lba = 0; lba < num_pages; lba++) {
+    time += ssd -> event_arrive(READ, lba, 1, time, &ret_status, address);
+    if((ret_status == FAILURE) || (!ssd->is_valid(lba, address))) {
+      fprintf(log_file_stream, "Error reading LBA %lu\n", lba);
+      failed(ssd);
+    }
+  }
+
+  fflush(log_file_stream);
+  fclose(log_file_stream);
+  delete ssd;
+  printf("SUCCESS ...Check %s for more details.\n", log_file_path);
+  return 0;
+}
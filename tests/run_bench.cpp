@@ -0,0 +1,110 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_bench.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+/* Event throughput benchmark
+ *
+ * measures how many events per second of processor time the discrete event
+ * 	core takes, first for the scheduler alone and then for the drive
+ * the scheduler keeps a given number of events pending, like the arrivals and
+ * 	completions of as many outstanding requests, and takes them in time
+ * 	order while scheduling a new one for each
+ * the drive is filled and read through Ssd::submit with every page submitted
+ * 	at once, each request being an arrival and a completion event
+ * the drive logs to run_bench.log */
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../ssd.h"
+
+using namespace ssd;
+
+/* processor time since start in seconds */
+double elapsed(clock_t start)
+{
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* take num_events events from the scheduler with pending events outstanding
+ * returns the events taken per second */
+double bench_scheduler(unsigned long num_events, unsigned long pending)
+{
+	Scheduler scheduler;
+	Sched_event event;
+	unsigned long i;
+	srand(1);
+	clock_t start = clock();
+	for(i = 0; i < pending; i++)
+		scheduler.schedule(rand() % 1000, ARRIVAL, i);
+	for(i = 0; i < num_events && scheduler.next(event, DBL_MAX); i++)
+		scheduler.schedule(event.time + rand() % 1000, event.type, event.tag);
+	return i / elapsed(start);
+}
+
+/* submit every page at once and run the drive until they complete
+ * returns the events taken per second */
+double bench_drive(Ssd &ssd, enum event_type type, unsigned long num_pages)
+{
+	Request request;
+	unsigned long lba;
+	unsigned long done = 0;
+	clock_t start = clock();
+	double time = ssd.get_time();
+	for(lba = 0; lba < num_pages; lba++)
+		(void) ssd.submit(type, lba, 1, time);
+	ssd.run();
+	while(ssd.get_completion(request))
+		if(request.status == SUCCESS)
+			done++;
+	if(done != num_pages)
+		fprintf(stderr, "%lu of %lu requests failed\n", num_pages - done, num_pages);
+	return 2 * num_pages / elapsed(start);
+}
+
+int main(int argc, char **argv){
+	unsigned long num_events = 1000000;
+	unsigned long num_pages;
+	unsigned long pending;
+
+	if(argc < 2) {
+		printf("usage: run_bench <config_file> [scheduler_events]\n");
+		exit(0);
+	}
+	load_config(argv[1]);
+	if(argc > 2 && atol(argv[2]) > 0)
+		num_events = atol(argv[2]);
+
+	FILE *log_file = NULL;
+	if((log_file = fopen("run_bench.log", "w")) == NULL){
+		printf("Could not open run_bench.log\n");
+		exit(-1);
+	}
+
+	for(pending = 16; pending <= 65536; pending *= 16)
+		printf("Scheduler, %lu pending: %.0lf events per second\n", pending, bench_scheduler(num_events, pending));
+
+	num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+		(unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+	Ssd *ssd = new Ssd(log_file);
+	printf("Drive, %lu writes: %.0lf events per second\n", num_pages, bench_drive(*ssd, WRITE, num_pages));
+	printf("Drive, %lu reads: %.0lf events per second\n", num_pages, bench_drive(*ssd, READ, num_pages));
+	delete ssd;
+	fclose(log_file);
+	return 0;
+}
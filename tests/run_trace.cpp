@@ -16,23 +16,67 @@
  * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
 
 /****************************************************************************/
-
 /* ASCII trace driver
  * Brendan Tauras 2009-05-21
  *
  * driver to run traces - just provide the ASCII trace file
- * not accurate, for test purposes only
- * goes through trace and treats read requests as writes to prepare the SSD
- * 	(requests will fail if there are multiple writes to same address)
- * then goes through the trace again as normal
- * 	(write requests may fail if they are attempts to overwrite) */
+ * replays the trace through the host interface to measure throughput against
+ * 	queue depth, for each depth given (HOST_QUEUE_DEPTH if none is)
+ * requests are split into page commands and dealt to the HOST_NUM_QUEUES
+ * 	queues in turn, each queue kept at the depth; arrival times in the trace
+ * 	are ignored so that the drive is never idle
+ * each depth runs on a new SSD that first has every page the trace reads
+ * 	written, at the same depth
+ * the drive logs to run_trace.log */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <vector>
 #include "../ssd.h"
 
 using namespace ssd;
 
+struct Command
+{
+	enum event_type type;
+	unsigned long logical_address;
+};
+
+/* run the commands with every queue kept at depth outstanding
+ * returns the time taken and the sum of the command latencies */
+double replay(Ssd &ssd, const std::vector<Command> &commands, unsigned int depth, double &latency_total)
+{
+	Host_interface host(ssd, HOST_NUM_QUEUES, depth);
+	std::vector<unsigned long> next(HOST_NUM_QUEUES);
+	double start = host.get_time();
+	unsigned long done = 0;
+	unsigned long id;
+	unsigned int queue;
+	Request request;
+
+	/* queue q takes commands q, q + HOST_NUM_QUEUES, ... */
+	for(queue = 0; queue < HOST_NUM_QUEUES; queue++)
+		next[queue] = queue;
+	latency_total = 0;
+	while(done < commands.size())
+	{
+		for(queue = 0; queue < HOST_NUM_QUEUES; queue++)
+			for(; next[queue] < commands.size() && host.get_outstanding(queue) < depth; next[queue] += HOST_NUM_QUEUES)
+				(void) host.submit(queue, commands[next[queue]].type, commands[next[queue]].logical_address, 1, host.get_time(), id);
+		if(!host.step())
+			break;
+		for(queue = 0; queue < HOST_NUM_QUEUES; queue++)
+			while(host.get_completion(queue, request))
+			{
+				if(request.status != SUCCESS)
+					fprintf(stderr, "Command for LBA %lu failed\n", request.logical_address);
+				latency_total += request.finish_time - request.arrive_time;
+				done++;
+			}
+	}
+	return host.get_time() - start;
+}
+
 int main(int argc, char **argv){
 	double arrive_time;
 	unsigned int diskno;
@@ -40,66 +84,73 @@ int main(int argc, char **argv){
 	unsigned int size;
 	unsigned int op;
 	char line[80];
-	double read_time = 0;
-	double write_time = 0;
-	double read_total = 0;
-	double write_total = 0;
-	unsigned long num_reads = 0;
-	unsigned long num_writes = 0;
-
-  if(argc != 3) {
-    printf("usage: run_trace <trace_file> <config_file>\n");
+	unsigned long num_pages;
+	unsigned int i;
+	std::vector<Command> commands;
+	std::vector<Command> prepare;
+	std::vector<bool> read;
+
+  if(argc < 3) {
+    printf("usage: run_trace <trace_file> <config_file> [queue_depth ...]\n");
     exit(0);
   }
 	load_config(argv[2]);
 	print_config(NULL);
-	printf("Press ENTER to continue...");
-	getchar();
-	printf("\n");
-
-	Ssd ssd;
 
 	FILE *trace = NULL;
 	if((trace = fopen(argv[1], "r")) == NULL){
 		printf("Please provide trace file name\n");
 		exit(-1);
 	}
-
-	printf("INITIALIZING SSD\n");
-
-	/* first go through and write to all read addresses to prepare the SSD */
-	while(fgets(line, 80, trace) != NULL){
-		sscanf(line, "%lf %u %lu %u %u", &arrive_time, &diskno, &vaddr, &size, &op);
-		vaddr %= 65536;
-		if(op == 1)
-			(void) ssd.event_arrive(WRITE, vaddr, size, arrive_time);
+	FILE *log_file = NULL;
+	if((log_file = fopen("run_trace.log", "w")) == NULL){
+		printf("Could not open run_trace.log\n");
+		exit(-1);
 	}
 
-	printf("STARTING TRACE\n");
+	/* pages the host can address */
+	num_pages = (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE -
+		(unsigned long) (((float) OVERPROVISIONING / 100) * SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE)) * BLOCK_SIZE;
+	read.assign(num_pages, false);
 
-	/* now rewind file and run trace */
-	fseek(trace, 0, SEEK_SET);
+	/* split the requests into page commands and note the pages read */
 	while(fgets(line, 80, trace) != NULL){
-		sscanf(line, "%lf %u %lu %u %u", &arrive_time, &diskno, &vaddr, &size, &op);
-		vaddr %= 65536;
-		if(op == 0){
-			write_time = ssd.event_arrive(WRITE, vaddr, size, arrive_time);
-			if(write_time != 0){
-				write_total += write_time;
-				num_writes++;
-			}
-		} else if(op == 1){
-			read_time = ssd.event_arrive(READ, vaddr, size, arrive_time);
-			if(read_time != 0){
-				read_total += read_time;
-				num_reads++;
-			}
-		} else
+		if(sscanf(line, "%lf %u %lu %u %u", &arrive_time, &diskno, &vaddr, &size, &op) != 5)
+			continue;
+		if(op > 1){
 			fprintf(stderr, "Bad operation in trace\n");
+			continue;
+		}
+		for(i = 0; i < size; i++){
+			Command command;
+			command.type = op == 0 ? WRITE : READ;
+			command.logical_address = (vaddr + i) % num_pages;
+			commands.push_back(command);
+			if(op == 1 && !read[command.logical_address]){
+				read[command.logical_address] = true;
+				command.type = WRITE;
+				prepare.push_back(command);
+			}
+		}
+	}
+	fclose(trace);
+
+	std::vector<unsigned int> depths;
+	for(i = 3; i < (unsigned int) argc; i++)
+		if(atoi(argv[i]) > 0)
+			depths.push_back(atoi(argv[i]));
+	if(depths.empty())
+		depths.push_back(HOST_QUEUE_DEPTH);
+
+	printf("%lu commands, %lu pages written first, %u queues\n", (unsigned long) commands.size(), (unsigned long) prepare.size(), HOST_NUM_QUEUES);
+	for(i = 0; i < depths.size(); i++){
+		double latency_total;
+		Ssd *ssd = new Ssd(log_file);
+		(void) replay(*ssd, prepare, depths[i], latency_total);
+		double time = replay(*ssd, commands, depths[i], latency_total);
+		printf("Queue depth %u: %.6lf time, %.6lf commands per unit time, %.6lf mean latency\n", depths[i], time, commands.size() / time, latency_total / commands.size());
+		delete ssd;
 	}
-	printf("Num reads : %lu\n", num_reads);
-	printf("Num writes: %lu\n", num_reads);
-	printf("Avg read time : %.20lf\n", read_time / num_reads);
-	printf("Avg write time: %.20lf\n", write_time / num_writes);
+	fclose(log_file);
 	return 0;
 }